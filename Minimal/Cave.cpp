@@ -1,72 +1,44 @@
 #define _CRT_SECURE_NO_DEPRECATE
 #include "Cave.h"
+#include "GLState.h"
+#include <glm/glm.hpp>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cstddef>
+#include <algorithm>
 
 
-// LEFT Vertices
-const GLfloat lvertices[18] = {
-	-2.0, -2.0, -2.0,
-	-2.0, -2.0,  2.0,
-	-2.0,  2.0,  2.0,
-	-2.0,  2.0,  2.0,
-	-2.0,  2.0, -2.0,
-	-2.0, -2.0, -2.0
+// Default walls in model space: lower left, lower right, upper left
+const glm::vec3 defaultCorners[3][3] = {
+	{ glm::vec3(-2.0f, -2.0f,  2.0f), glm::vec3(-2.0f, -2.0f, -2.0f), glm::vec3(-2.0f,  2.0f,  2.0f) }, // LEFT
+	{ glm::vec3(-2.0f, -2.0f, -2.0f), glm::vec3( 2.0f, -2.0f, -2.0f), glm::vec3(-2.0f,  2.0f, -2.0f) }, // RIGHT
+	{ glm::vec3(-2.0f, -2.0f,  2.0f), glm::vec3( 2.0f, -2.0f,  2.0f), glm::vec3(-2.0f, -2.0f, -2.0f) }  // BOTTOM
 };
-
-// RIGHT Vertices
-const GLfloat rvertices[] = {
-	-2.0,  2.0, -2.0,
-	2.0,  2.0, -2.0,
-	2.0, -2.0, -2.0,
-	2.0, -2.0, -2.0,
-	-2.0, -2.0, -2.0,
-	-2.0,  2.0, -2.0
-};
-
-// BOTTOM Vertices
-const GLfloat bvertices[] = {
-	-2.0, -2.0, -2.0,
-	2.0, -2.0, -2.0,
-	2.0, -2.0,  2.0,
-	2.0, -2.0,  2.0,
-	-2.0, -2.0,  2.0,
-	-2.0, -2.0, -2.0
-};
-
-// LEFT Texture Coordinates
-const GLfloat luvs[] = {
-	1.0f, 0.0f,
-	0.0f, 0.0f,
-	0.0f, 1.0f,
-	0.0f, 1.0f,
-	1.0f, 1.0f,
-	1.0f, 0.0f,
-};
-
-// RIGHT Texture Coordinates
-const GLfloat ruvs[] = {
-	0.0f, 1.0f,
-	1.0f, 1.0f,
-	1.0f, 0.0f,
-	1.0f, 0.0f,
-	0.0f, 0.0f,
-	0.0f, 1.0f,
-};
-
-// BOTTOM Texture Coordinates
-const GLfloat buvs[] = {
-	0.0f, 1.0f,
-	1.0f, 1.0f,
-	1.0f, 0.0f,
-	1.0f, 0.0f,
-	0.0f, 0.0f,
-	0.0f, 1.0f
+const char* defaultNames[3] = { "LEFT", "RIGHT", "BOTTOM" };
+const int defaultResolution = 2048;
+
+// Interleaved cave vertex, wall selects the layer of the wall image array
+struct CaveVertex {
+	glm::vec3 position;
+	glm::vec2 uv;
+	GLint wall;
 };
 
 // Constructor
-Cave::Cave()
+Cave::Cave(const char* configFile) : colorFormat(GL_RGBA8), wallsPerPass(0), foveated(false), portal(false), analyticSky(false), quads(QUADS_OFF), locationProgram(0), wallsValid(false)
 {
+	if (!loadConfig(configFile)) {
+		for (int i = 0; i < 3; i++) {
+			Wall wall;
+			wall.name = defaultNames[i];
+			wall.corners[0] = defaultCorners[i][0];
+			wall.corners[1] = defaultCorners[i][1];
+			wall.corners[2] = defaultCorners[i][2];
+			wall.resolution = glm::ivec2(defaultResolution);
+			walls.push_back(wall);
+		}
+	}
 	initialize();
 }
 
@@ -74,15 +46,136 @@ Cave::Cave()
 Cave::~Cave()
 {
 	// Delete previously generated buffers
-	glDeleteVertexArrays(1, &lVAO);
-	glDeleteVertexArrays(1, &rVAO);
-	glDeleteVertexArrays(1, &bVAO);
-	glDeleteBuffers(1, &lVBO);
-	glDeleteBuffers(1, &rVBO);
-	glDeleteBuffers(1, &bVBO);
-	glDeleteBuffers(1, &luv_ID);
-	glDeleteBuffers(1, &ruv_ID);
-	glDeleteBuffers(1, &buv_ID);
+	GLState::deleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+}
+
+// Config Loader
+bool Cave::loadConfig(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		std::cerr << "could not open cave config " << filename << ", using the default walls" << std::endl;
+		return false;
+	}
+
+	std::vector<Wall> loaded;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		std::istringstream in(line);
+		std::string keyword;
+		if (!(in >> keyword) || keyword[0] == '#') {
+			continue;
+		}
+
+		if (keyword == "format") {
+			std::string name;
+			in >> name;
+			if (name == "RGBA8") colorFormat = GL_RGBA8;
+			else if (name == "R11G11B10F") colorFormat = GL_R11F_G11F_B10F;
+			else if (name == "RGB565") colorFormat = GL_RGB565;
+			else std::cerr << "unknown wall format " << name << " in " << filename << " line " << lineNumber << std::endl;
+			continue;
+		}
+		if (keyword == "skybox") {
+			std::string mode;
+			in >> mode;
+			if (mode == "raster") analyticSky = false;
+			else if (mode == "analytic") analyticSky = true;
+			else std::cerr << "unknown skybox mode " << mode << " in " << filename << " line " << lineNumber << std::endl;
+			continue;
+		}
+		if (keyword == "quads") {
+			std::string mode;
+			in >> mode;
+			if (mode == "off") quads = QUADS_OFF;
+			else if (mode == "sdk") quads = QUADS_SDK;
+			else if (mode == "eyebuffer") quads = QUADS_EYE_BUFFER;
+			else std::cerr << "unknown quads mode " << mode << " in " << filename << " line " << lineNumber << std::endl;
+			continue;
+		}
+		if (keyword == "portal") {
+			int enabled;
+			if (!(in >> enabled)) {
+				std::cerr << "error parsing cave config " << filename << " line " << lineNumber << std::endl;
+				enabled = 0;
+			}
+			portal = enabled != 0;
+			continue;
+		}
+		// Read by EyeBufferConfig
+		if (keyword == "stereo" || keyword == "lensmask" || keyword == "dynres" || keyword == "multires") {
+			continue;
+		}
+		if (keyword == "foveate") {
+			int enabled;
+			if (!(in >> enabled)) {
+				std::cerr << "error parsing cave config " << filename << " line " << lineNumber << std::endl;
+				enabled = 0;
+			}
+			foveated = enabled != 0;
+			continue;
+		}
+		if (keyword == "amortize") {
+			if (!(in >> wallsPerPass) || wallsPerPass < 0) {
+				std::cerr << "error parsing cave config " << filename << " line " << lineNumber << std::endl;
+				wallsPerPass = 0;
+			}
+			continue;
+		}
+
+		Wall wall;
+		int enabled;
+		glm::vec3* c = wall.corners;
+		if (keyword != "wall" || !(in >> wall.name >> wall.resolution.x >> wall.resolution.y >> enabled
+			>> c[0].x >> c[0].y >> c[0].z >> c[1].x >> c[1].y >> c[1].z >> c[2].x >> c[2].y >> c[2].z)) {
+			std::cerr << "error parsing cave config " << filename << " line " << lineNumber << std::endl;
+			return false;
+		}
+		if (!enabled) {
+			continue;
+		}
+		if ((int)loaded.size() == MAX_WALLS) {
+			std::cerr << "cave config " << filename << " enables more than " << MAX_WALLS << " walls, ignoring " << wall.name << std::endl;
+			continue;
+		}
+		wall.resolution = glm::clamp(wall.resolution, glm::ivec2(1), glm::ivec2(defaultResolution));
+		loaded.push_back(wall);
+	}
+
+	if (portal && (foveated || wallsPerPass > 0)) {
+		std::cerr << "cave config " << filename << " enables portal mode, foveate and amortize are ignored" << std::endl;
+		foveated = false;
+		wallsPerPass = 0;
+	}
+	if (portal && quads != QUADS_OFF) {
+		std::cerr << "cave config " << filename << " enables portal mode, quads are ignored" << std::endl;
+		quads = QUADS_OFF;
+	}
+	// Quads show the wall images as they are, without the Cave shader
+	if (quads != QUADS_OFF && (foveated || wallsPerPass > 0 || analyticSky)) {
+		std::cerr << "cave config " << filename << " enables quads, foveate, amortize and the analytic skybox are ignored" << std::endl;
+		foveated = false;
+		wallsPerPass = 0;
+		analyticSky = false;
+	}
+	if (foveated && wallsPerPass > 0) {
+		std::cerr << "cave config " << filename << " enables foveate and amortize, amortize is ignored" << std::endl;
+		wallsPerPass = 0;
+	}
+	if (analyticSky && !portal && colorFormat != GL_RGBA8) {
+		std::cerr << "cave config " << filename << " uses the analytic skybox, which needs wall alpha, using RGBA8" << std::endl;
+		colorFormat = GL_RGBA8;
+	}
+	if (loaded.empty()) {
+		std::cerr << "cave config " << filename << " enables no walls, using the default walls" << std::endl;
+		return false;
+	}
+	walls = loaded;
+	return true;
 }
 
 // Initialize
@@ -90,147 +183,250 @@ void Cave::initialize() {
 
 	toWorld = glm::mat4(1.0f);
 
-	// LEFT
-	glGenVertexArrays(1, &lVAO);
-	glGenBuffers(1, &lVBO);
-	glGenBuffers(1, &luv_ID);
-
-	glBindVertexArray(lVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, lVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(lvertices), &lvertices, GL_STATIC_DRAW);
+	// Two triangles per wall. Texture coordinates run from pa (0, 0) towards pb in u and pc in v
+	std::vector<CaveVertex> vertices;
+	std::vector<GLushort> indices;
+	for (int i = 0; i < wallCount(); i++) {
+		const glm::vec3& pa = walls[i].corners[0];
+		const glm::vec3& pb = walls[i].corners[1];
+		const glm::vec3& pc = walls[i].corners[2];
+
+		GLushort base = (GLushort)vertices.size();
+		vertices.push_back({ pa, glm::vec2(0.0f, 0.0f), i });
+		vertices.push_back({ pb, glm::vec2(1.0f, 0.0f), i });
+		vertices.push_back({ pb + (pc - pa), glm::vec2(1.0f, 1.0f), i });
+		vertices.push_back({ pc, glm::vec2(0.0f, 1.0f), i });
+
+		// Clockwise seen from inside like the original quads, the skybox leaves front faces culled
+		const GLushort quad[6] = { 1, 0, 3, 3, 2, 1 };
+		for (GLushort index : quad) {
+			indices.push_back(base + index);
+		}
+	}
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0,// This first parameter x should be the same as the number passed into the line "layout (location = x)" in the vertex shader. In this case, it's 0. Valid values are 0 to GL_MAX_UNIFORM_LOCATIONS.
-		3, // This second line tells us how any components there are per vertex. In this case, it's 3 (we have an x, y, and z component)
-		GL_FLOAT, // What type these components are
-		GL_FALSE, // GL_TRUE means the values should be normalized. GL_FALSE means they shouldn't
-		3 * sizeof(GLfloat), // Offset between consecutive indices. Since each of our vertices have 3 floats, they should have the size of 3 floats in between
-		(GLvoid*)0); // Offset of the first vertex's component. In our case it's 0 since we don't pad the vertices array with anything.
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
 
-	glBindBuffer(GL_ARRAY_BUFFER, luv_ID);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(luvs), luvs, GL_STATIC_DRAW);
+	GLState::bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CaveVertex), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
 
+	// Position
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CaveVertex), (GLvoid*)offsetof(CaveVertex, position));
+	// Texture coordinates
 	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1,// This first parameter x should be the same as the number passed into the line "layout (location = x)" in the vertex shader.
-		2, // This second line tells us how any components there are per vertex. In this case, it's 3 (we have an x, y, and z component)
-		GL_FLOAT, // What type these components are
-		GL_FALSE, // GL_TRUE means the values should be normalized. GL_FALSE means they shouldn't
-		2 * sizeof(GLfloat), // Offset between consecutive indices. Since each of our vertices have 3 floats, they should have the size of 3 floats in between
-		(GLvoid*)0); // Offset of the first vertex's component. In our case it's 0 since we don't pad the vertices array with anything.
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(CaveVertex), (GLvoid*)offsetof(CaveVertex, uv));
+	// Wall index, an integer attribute
+	glEnableVertexAttribArray(2);
+	glVertexAttribIPointer(2, 1, GL_INT, sizeof(CaveVertex), (GLvoid*)offsetof(CaveVertex, wall));
 
+	// The element buffer binding is VAO state, unbind the VAO first
+	GLState::bindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	// RIGHT
-	glGenVertexArrays(1, &rVAO);
-	glGenBuffers(1, &rVBO);
-	glGenBuffers(1, &ruv_ID);
+	// Load Texture
+	this->loadTexture();
+}
 
-	glBindVertexArray(rVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, rVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(rvertices), &rvertices, GL_STATIC_DRAW);
+// Point the samplers of a program at their units when it differs from the last one used
+void Cave::findUniforms(GLuint shaderProgram)
+{
+	if (shaderProgram != locationProgram) {
+		// Every sampler gets its own unit, samplers of different types may not share one
+		const GLint colorUnits[EYES] = { 0, 3 }, depthUnits[EYES] = { 1, 4 }, skyUnits[EYES] = { 2, 5 };
+		uColorTextures.set(shaderProgram, colorUnits, EYES);
+		uDepthTextures.set(shaderProgram, depthUnits, EYES);
+		uSkyboxes.set(shaderProgram, skyUnits, EYES);
+		locationProgram = shaderProgram;
+	}
+}
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0,// This first parameter x should be the same as the number passed into the line "layout (location = x)" in the vertex shader. In this case, it's 0. Valid values are 0 to GL_MAX_UNIFORM_LOCATIONS.
-		3, // This second line tells us how any components there are per vertex. In this case, it's 3 (we have an x, y, and z component)
-		GL_FLOAT, // What type these components are
-		GL_FALSE, // GL_TRUE means the values should be normalized. GL_FALSE means they shouldn't
-		3 * sizeof(GLfloat), // Offset between consecutive indices. Since each of our vertices have 3 floats, they should have the size of 3 floats in between
-		(GLvoid*)0); // Offset of the first vertex's component. In our case it's 0 since we don't pad the vertices array with anything.
+void Cave::setWalls(GLuint shaderProgram, const EyeWalls* eyes, int eyeCount)
+{
+	// shader.frag keeps eye e's entries after those of the eyes before it
+	glm::vec2 uvScale[EYES * 2 * MAX_WALLS];
+	glm::vec3 eyePos[EYES];
+	glm::mat4 toCurrent[EYES * MAX_WALLS], toOld[EYES * MAX_WALLS];
+	glm::vec4 insetRect[EYES * MAX_WALLS];
+	glm::mat3 skyRotation[EYES];
+	int staleMask[EYES] = {}, insetMask[EYES] = {}, skyMask[EYES] = {};
+	float skySize = 0.0f;
+
+	for (int e = 0; e < eyeCount; e++) {
+		const EyeWalls& eye = eyes[e];
+		const WallTarget& target = *eye.target;
+
+		// Walls first, then any inset layers
+		int layers = std::min((int)target.layers, 2 * MAX_WALLS);
+		for (int i = 0; i < layers; i++) {
+			uvScale[e * 2 * MAX_WALLS + i] = target.uvScale(i);
+		}
+
+		if (eye.insets && eye.insets->mask != 0 && target.layers >= 2 * wallCount()) {
+			insetMask[e] = eye.insets->mask;
+			std::copy(eye.insets->rect, eye.insets->rect + MAX_WALLS, insetRect + e * MAX_WALLS);
+		}
+
+		if (eye.reprojection && eye.reprojection->staleMask != 0) {
+			staleMask[e] = eye.reprojection->staleMask;
+			eyePos[e] = eye.reprojection->eyePos;
+			std::copy(eye.reprojection->toCurrent, eye.reprojection->toCurrent + MAX_WALLS, toCurrent + e * MAX_WALLS);
+			std::copy(eye.reprojection->toOld, eye.reprojection->toOld + MAX_WALLS, toOld + e * MAX_WALLS);
+			GLState::activeTexture(GL_TEXTURE0 + 3 * e + 1);
+			GLState::bindTexture(GL_TEXTURE_2D_ARRAY, target.depthTexture);
+		}
+
+		// Reprojection and sky share the eye position, both come from the same pass
+		if (eye.sky) {
+			skyMask[e] = eye.sky->mask;
+			skyRotation[e] = eye.sky->rotation;
+			skySize = eye.sky->halfSize;
+			eyePos[e] = eye.sky->eyePos;
+			GLState::activeTexture(GL_TEXTURE0 + 3 * e + 2);
+			GLState::bindTexture(GL_TEXTURE_CUBE_MAP, eye.sky->cubeMap);
+		}
+
+		GLState::activeTexture(GL_TEXTURE0 + 3 * e);
+		GLState::bindTexture(GL_TEXTURE_2D_ARRAY, target.colorTexture);
+	}
+	GLState::activeTexture(GL_TEXTURE0);
+
+	uUVScale.set(shaderProgram, uvScale, eyeCount * 2 * MAX_WALLS);
+	uInsetMask.set(shaderProgram, insetMask, eyeCount);
+	uInsetLayer.set(shaderProgram, wallCount());
+	uInsetRect.set(shaderProgram, insetRect, eyeCount * MAX_WALLS);
+	uStaleMask.set(shaderProgram, staleMask, eyeCount);
+	uEyePos.set(shaderProgram, eyePos, eyeCount);
+	uToCurrent.set(shaderProgram, toCurrent, eyeCount * MAX_WALLS);
+	uToOld.set(shaderProgram, toOld, eyeCount * MAX_WALLS);
+	uSkyMask.set(shaderProgram, skyMask, eyeCount);
+	uSkyRotation.set(shaderProgram, skyRotation, eyeCount);
+	uSkySize.set(shaderProgram, skySize);
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, ruv_ID);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(ruvs), ruvs, GL_STATIC_DRAW);
+void Cave::unbindWalls(int eyeCount)
+{
+	for (int e = 0; e < eyeCount; e++) {
+		GLState::activeTexture(GL_TEXTURE0 + 3 * e);
+		GLState::bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		GLState::activeTexture(GL_TEXTURE0 + 3 * e + 1);
+		GLState::bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		GLState::activeTexture(GL_TEXTURE0 + 3 * e + 2);
+		GLState::bindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	}
+	GLState::activeTexture(GL_TEXTURE0);
+}
 
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1,// This first parameter x should be the same as the number passed into the line "layout (location = x)" in the vertex shader.
-		2, // This second line tells us how any components there are per vertex. In this case, it's 3 (we have an x, y, and z component)
-		GL_FLOAT, // What type these components are
-		GL_FALSE, // GL_TRUE means the values should be normalized. GL_FALSE means they shouldn't
-		2 * sizeof(GLfloat), // Offset between consecutive indices. Since each of our vertices have 3 floats, they should have the size of 3 floats in between
-		(GLvoid*)0); // Offset of the first vertex's component. In our case it's 0 since we don't pad the vertices array with anything.
+// Draw
+void Cave::draw(GLuint shaderProgram, const WallTarget& target,
+	const Reprojection* reprojection, const Insets* insets, const Sky* sky)
+{
+	findUniforms(shaderProgram);
+	// Now send these values to the shader program, the eye comes from PerView
+	uView.set(shaderProgram, toWorld);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	const EyeWalls eye = { &target, reprojection, insets, sky };
+	setWalls(shaderProgram, &eye, 1);
 
+	// All walls live in one texture array and one index buffer, draw them in one call
+	GLState::bindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, wallCount() * 6, GL_UNSIGNED_SHORT, (GLvoid*)0);
 
-	// BOTTOM
-	glGenVertexArrays(1, &bVAO);
-	glGenBuffers(1, &bVBO);
-	glGenBuffers(1, &buv_ID);
+	unbindWalls(1);
+}
 
-	glBindVertexArray(bVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, bVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(bvertices), &bvertices, GL_STATIC_DRAW);
+// Draw several views
+void Cave::drawViews(GLuint shaderProgram, const ViewSet& views, const EyeWalls eyes[EYES])
+{
+	findUniforms(shaderProgram);
+	setWalls(shaderProgram, eyes, EYES);
+	drawViews(shaderProgram, views);
+	unbindWalls(EYES);
+}
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0,// This first parameter x should be the same as the number passed into the line "layout (location = x)" in the vertex shader. In this case, it's 0. Valid values are 0 to GL_MAX_UNIFORM_LOCATIONS.
-		3, // This second line tells us how any components there are per vertex. In this case, it's 3 (we have an x, y, and z component)
-		GL_FLOAT, // What type these components are
-		GL_FALSE, // GL_TRUE means the values should be normalized. GL_FALSE means they shouldn't
-		3 * sizeof(GLfloat), // Offset between consecutive indices. Since each of our vertices have 3 floats, they should have the size of 3 floats in between
-		(GLvoid*)0); // Offset of the first vertex's component. In our case it's 0 since we don't pad the vertices array with anything.
+void Cave::drawViews(GLuint shaderProgram, const ViewSet& views)
+{
+	findUniforms(shaderProgram);
+	views.upload(shaderProgram);
+	uView.set(shaderProgram, toWorld);
 
-	glBindBuffer(GL_ARRAY_BUFFER, buv_ID);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(buvs), buvs, GL_STATIC_DRAW);
+	// cave_stereo.geom repeats every triangle per view
+	GLState::bindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, wallCount() * 6, GL_UNSIGNED_SHORT, (GLvoid*)0);
+}
 
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1,// This first parameter x should be the same as the number passed into the line "layout (location = x)" in the vertex shader.
-		2, // This second line tells us how any components there are per vertex. In this case, it's 3 (we have an x, y, and z component)
-		GL_FLOAT, // What type these components are
-		GL_FALSE, // GL_TRUE means the values should be normalized. GL_FALSE means they shouldn't
-		2 * sizeof(GLfloat), // Offset between consecutive indices. Since each of our vertices have 3 floats, they should have the size of 3 floats in between
-		(GLvoid*)0); // Offset of the first vertex's component. In our case it's 0 since we don't pad the vertices array with anything.
+// Draw a single wall
+void Cave::drawWall(GLuint shaderProgram, int wall)
+{
+	findUniforms(shaderProgram);
+	uView.set(shaderProgram, toWorld);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	GLState::bindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(wall * 6 * sizeof(GLushort)));
+}
 
-	// Load Texture
-	this->loadTexture();
+glm::ivec2 Cave::maxResolution() const
+{
+	glm::ivec2 resolution(0);
+	for (const Wall& wall : walls) {
+		resolution = glm::max(resolution, wall.resolution);
+	}
+	return resolution;
 }
 
-// Draw
-void Cave::draw(GLuint shaderProgram, glm::mat4 Projection, glm::mat4 View, GLuint left, GLuint right, GLuint bottom)
+// World space walls
+bool Cave::updateWalls()
 {
-	
-	uProjection = glGetUniformLocation(shaderProgram, "projection");
-	uModel = glGetUniformLocation(shaderProgram, "model");
-	uView = glGetUniformLocation(shaderProgram, "view");
-	// Now send these values to the shader program
-	glUniformMatrix4fv(uProjection, 1, GL_FALSE, &Projection[0][0]);
-	glUniformMatrix4fv(uModel, 1, GL_FALSE, &View[0][0]);
-	glUniformMatrix4fv(uView, 1, GL_FALSE, &toWorld[0][0]);
-
-	glUniform1i(glGetUniformLocation(shaderProgram, "textureShader"), 0);
-
-	// LEFT
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, left);
-	glBindVertexArray(lVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, luv_ID);
-	glDrawArrays(GL_TRIANGLES, 0, 2 * 3);
-
-	// RIGHT
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, right);
-	glBindVertexArray(rVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, ruv_ID);
-	glDrawArrays(GL_TRIANGLES, 0, 2 * 3);
-
-	// BOTTOM
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, bottom);
-	glBindVertexArray(bVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, buv_ID);
-	glDrawArrays(GL_TRIANGLES, 0, 2 * 3);
-
-	glBindVertexArray(0);
+	if (wallsValid && wallsToWorld == toWorld) {
+		return false;
+	}
+
+	corners.clear();
+	for (Wall& wall : walls) {
+		wall.pa = glm::vec3(toWorld * glm::vec4(wall.corners[0], 1.0f));
+		wall.pb = glm::vec3(toWorld * glm::vec4(wall.corners[1], 1.0f));
+		wall.pc = glm::vec3(toWorld * glm::vec4(wall.corners[2], 1.0f));
+
+		wall.vr = glm::normalize(wall.pb - wall.pa);
+		wall.vu = glm::normalize(wall.pc - wall.pa);
+		wall.vn = glm::normalize(glm::cross(wall.vr, wall.vu));
+
+		wall.rotation = glm::transpose(glm::mat4(wall.vr.x, wall.vr.y, wall.vr.z, 0.0f,
+			wall.vu.x, wall.vu.y, wall.vu.z, 0.0f,
+			wall.vn.x, wall.vn.y, wall.vn.z, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f));
+
+		// Neighbouring walls share edges, keep every corner once
+		const glm::vec3 quad[4] = { wall.pa, wall.pb, wall.pc, wall.pb + (wall.pc - wall.pa) };
+		for (const glm::vec3& corner : quad) {
+			bool shared = false;
+			for (const glm::vec3& other : corners) {
+				if (glm::distance(corner, other) < 1e-4f) {
+					shared = true;
+					break;
+				}
+			}
+			if (!shared) {
+				corners.push_back(corner);
+			}
+		}
+	}
+
+	wallsToWorld = toWorld;
+	wallsValid = true;
+	return true;
 }
 
 // Texture Loader
 void Cave::loadTexture() {
 
 	glGenTextures(1, &texture_ID);
-	glBindTexture(GL_TEXTURE_2D, texture_ID);
+	GLState::bindTexture(GL_TEXTURE_2D, texture_ID);
 
 	int width, height;
 	unsigned char* image;
@@ -249,7 +445,7 @@ void Cave::loadTexture() {
 	free(image);
 
 	// Unbind texture
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLState::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Cave::useCubemap(int eyeIdx)
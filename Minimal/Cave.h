@@ -15,16 +15,139 @@
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "WallTarget.h"
+#include "ViewSet.h"
+#include "Program.h"
+#include <string>
+#include <vector>
+
+// CAVE made of up to MAX_WALLS flat projection screens. The walls are read from
+// a config file, one line per wall:
+//   wall <name> <width> <height> <enabled> <lower left xyz> <lower right xyz> <upper left xyz>
+// with corners in cave model space, and optionally the wall image format and
+// the number of walls refreshed per pass, 0 refreshes all of them:
+//   format <RGBA8 | R11G11B10F | RGB565>
+//   amortize <walls per pass>
+// or render each wall as a low density periphery plus a full density inset
+// around the point the HMD looks at:
+//   foveate <0 | 1>
+// or skip the wall images and draw the scene straight into each wall's part of
+// the eye buffer:
+//   portal <0 | 1>
+// The skybox is either rasterized into the wall images or looked up per
+// fragment when the walls are drawn, the images then only hold the cubes:
+//   skybox <raster | analytic>
+// or render each wall once per frame from between the eyes and hand it to the
+// compositor as a quad layer, or to a stand-in that composites into the eye buffer:
+//   quads <off | sdk | eyebuffer>
+// The eye buffer lines of the same file are left to EyeBufferConfig.
+// Without a config the classic LEFT, RIGHT and BOTTOM walls are used.
 class Cave
 {
 public:
-	Cave();
+	// Matches MAX_WALLS in wall.geom, one geometry shader invocation per wall
+	enum { MAX_WALLS = 6 };
+	// Matches EYES in shader.frag and the stereo geometry shaders
+	enum { EYES = 2 };
+
+	Cave(const char* configFile = "cave.cfg");
 	~Cave();
 
 	glm::mat4 toWorld;
 
+	// Internal format of the wall images
+	GLenum colorFormat;
+	// Walls refreshed per pass in amortized mode, 0 refreshes every wall
+	int wallsPerPass;
+	// Foveated mode, layer wallCount() + i holds the inset of wall i
+	bool foveated;
+	// Portal mode, the scene is drawn through stencil masked walls instead of wall images
+	bool portal;
+	// Analytic skybox, the wall images hold the cubes over alpha 0 and the skybox is looked up behind them
+	bool analyticSky;
+	// Quad mode, the walls are compositor layers and the eye buffer shows them through alpha 0
+	enum QuadMode { QUADS_OFF, QUADS_SDK, QUADS_EYE_BUFFER };
+	QuadMode quads;
+
+	// One projection screen: pa lower left, pb lower right, pc upper left in world space
+	struct Wall {
+		std::string name;
+		// Corners in model space, as read from the config
+		glm::vec3 corners[3];
+		// Largest image the wall is rendered at
+		glm::ivec2 resolution;
+
+		glm::vec3 pa, pb, pc;
+		// Orthonormal screen basis: right, up and normal towards the viewer
+		glm::vec3 vr, vu, vn;
+		// Rotates world space into screen space, rows vr, vu, vn
+		glm::mat4 rotation;
+	};
+
+	// Read the enabled walls from a config file, false if it can't be used
+	bool loadConfig(const char* filename);
+
+	// Recompute the world space walls if toWorld changed since the last call, returns true if it did
+	bool updateWalls();
+	const std::vector<Wall>& getWalls() const { return walls; }
+	int wallCount() const { return (int)walls.size(); }
+	// World space corners shared by the walls, each listed once
+	const std::vector<glm::vec3>& getCorners() const { return corners; }
+	// Resolution large enough for every wall
+	glm::ivec2 maxResolution() const;
+
 	void initialize();
-	void draw(GLuint shaderProgram, glm::mat4 Projection, glm::mat4 View, GLuint left, GLuint right, GLuint bottom);
+	// Warps wall images rendered from an older eye position to the current one
+	struct Reprojection {
+		// Walls whose image is older than the current eye position
+		int staleMask;
+		// Current eye position the walls are projected from
+		glm::vec3 eyePos;
+		// Old wall clip space to current world space, and back
+		glm::mat4 toCurrent[MAX_WALLS];
+		glm::mat4 toOld[MAX_WALLS];
+	};
+
+	// Foveal insets composited over the wall images
+	struct Insets {
+		// Walls with an inset
+		int mask;
+		// uv rectangle (u0, v0, u1, v1) of each inset on its wall
+		glm::vec4 rect[MAX_WALLS];
+	};
+
+	// Skybox composited behind the wall images in analytic mode
+	struct Sky {
+		// Walls showing the skybox, the others stay black behind the cubes
+		int mask;
+		GLuint cubeMap;
+		// Orientation and half size of the skybox cube in the view the walls are rendered with
+		glm::mat3 rotation;
+		float halfSize;
+		// Eye position the walls are projected from
+		glm::vec3 eyePos;
+	};
+
+	// target holds the image of wall i in layer i. With a reprojection the stale
+	// walls are warped through the depth kept in target, with insets the inset
+	// images are blended over their walls, with a sky the skybox fills in where
+	// the images are transparent. The eye is the one in the bound PerView slot.
+	void draw(GLuint shaderProgram, const WallTarget& target,
+		const Reprojection* reprojection = nullptr, const Insets* insets = nullptr, const Sky* sky = nullptr);
+	// Draw only wall i, for stencil and depth passes that don't sample the wall images
+	void drawWall(GLuint shaderProgram, int wall);
+
+	// What one eye's walls show, as passed to draw
+	struct EyeWalls {
+		const WallTarget* target;
+		const Reprojection* reprojection;
+		const Insets* insets;
+		const Sky* sky;
+	};
+	// Draw the walls to every view in one pass, a view of eye e shows eyes[e] like draw does
+	void drawViews(GLuint shaderProgram, const ViewSet& views, const EyeWalls eyes[EYES]);
+	// Draw every wall to every view without sampling the wall images
+	void drawViews(GLuint shaderProgram, const ViewSet& views);
 
 	// PPM Loader
 	unsigned char* loadPPM(const char* filename, int& width, int& height);
@@ -35,14 +158,35 @@ public:
 
 	// These variables are needed for the shader program
 
-	// GLuint VBO, VAO, uv_ID for LEfT, RIGHT, BOTTOM squares
-	GLuint lVBO, lVAO, luv_ID;
-	GLuint rVBO, rVAO, ruv_ID;
-	GLuint bVBO, bVAO, buv_ID;
+	// Four vertices per wall with position, uv and wall index interleaved, drawn as one indexed batch
+	GLuint VBO, EBO, VAO;
 
-	GLuint uProjection, uModel, uView;
+	// Uniforms, resolved once per program. The sampler units are set again only when a different program is passed to draw
+	GLuint locationProgram;
+	Uniform<glm::mat4> uView{ "view" };
+	Uniform<glm::vec2> uUVScale{ "uvScale" };
+	Uniform<GLint> uStaleMask{ "staleMask" };
+	Uniform<glm::vec3> uEyePos{ "eyePos" };
+	Uniform<glm::mat4> uToCurrent{ "toCurrent" }, uToOld{ "toOld" };
+	Uniform<GLint> uInsetMask{ "insetMask" }, uInsetLayer{ "insetLayer" };
+	Uniform<glm::vec4> uInsetRect{ "insetRect" };
+	Uniform<GLint> uSkyMask{ "skyMask" };
+	Uniform<glm::mat3> uSkyRotation{ "skyRotation" };
+	Uniform<GLfloat> uSkySize{ "skySize" };
+	Uniform<GLint> uColorTextures{ "textureShader" }, uDepthTextures{ "depthShader" }, uSkyboxes{ "skybox" };
 	GLuint texture_ID_left, texture_ID_right, texture_ID_self;
 	GLuint texture_ID, curTextureID;
+
+private:
+	void findUniforms(GLuint shaderProgram);
+	// Upload the wall uniforms of eyeCount eyes and bind their textures, eye e uses units 3e to 3e + 2
+	void setWalls(GLuint shaderProgram, const EyeWalls* eyes, int eyeCount);
+	void unbindWalls(int eyeCount);
+
+	std::vector<Wall> walls;
+	std::vector<glm::vec3> corners;
+	glm::mat4 wallsToWorld;
+	bool wallsValid;
 };
 
 #endif
\ No newline at end of file
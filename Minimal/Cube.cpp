@@ -1,4 +1,5 @@
 #include "Cube.h"
+#include "GLState.h"
 
 // Define the coordinates and indices needed to draw the cube. Note that it is not necessary
 // to use a 2-dimensional array, since the layout in memory is the same as a 1-dimensional array.
@@ -101,7 +102,7 @@ Cube::Cube() {
 
   // Bind the Vertex Array Object (VAO) first, then bind the associated buffers to it.
   // Consider the VAO as a container for all your buffers.
-  glBindVertexArray(VAO);
+  GLState::bindVertexArray(VAO);
 
   // Now bind a VBO to it as a GL_ARRAY_BUFFER. The GL_ARRAY_BUFFER is an array containing relevant data to what
   // you want to draw, such as vertices, normals, colors, etc.
@@ -147,35 +148,31 @@ Cube::Cube() {
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   // Unbind the VAO now so we don't accidentally tamper with it.
   // NOTE: You must NEVER unbind the element array buffer associated with a VAO!
-  glBindVertexArray(0);
+  GLState::bindVertexArray(0);
 }
 
 Cube::~Cube() {
   // Delete previously generated buffers. Note that forgetting to do this can waste GPU memory in a 
   // large project! This could crash the graphics driver due to memory leaks, or slow down application performance!
-  glDeleteVertexArrays(1, &VAO);
+  GLState::deleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &vertexBuffer);
   glDeleteBuffers(1, &normalBuffer);
 }
 
 void Cube::draw(GLuint shaderProgram, const glm::mat4& projection, const glm::mat4& view) {
-  glUseProgram(shaderProgram);
+  GLState::useProgram(shaderProgram);
   // Calculate the combination of the model and view (camera inverse) matrices
   glm::mat4 modelview = view * toWorld;
   // We need to calcullate this because modern OpenGL does not keep track of any matrix other than the viewport (D)
   // Consequently, we need to forward the projection, view, and model matrices to the shader programs
-  // Get the location of the uniform variables "projection" and "modelview"
-  uProjection = glGetUniformLocation(shaderProgram, "projection");
-  uModelview = glGetUniformLocation(shaderProgram, "modelview");
-  // Now send these values to the shader program
-  glUniformMatrix4fv(uProjection, 1, GL_FALSE, &projection[0][0]);
-  glUniformMatrix4fv(uModelview, 1, GL_FALSE, &modelview[0][0]);
+  // Send the uniform variables "projection" and "modelview" to the shader program
+  uProjection.set(shaderProgram, projection);
+  uModelview.set(shaderProgram, modelview);
   // Now draw the cube. We simply need to bind the VAO associated with it.
-  glBindVertexArray(VAO);
+  GLState::bindVertexArray(VAO);
   // Tell OpenGL to draw with triangles
   glDrawArrays(GL_TRIANGLES, 0, 3 * 2 * 6); // 3 vertices per triangle, 2 triangles per face, 6 faces
-  // Unbind the VAO when we're done so we don't accidentally draw extra stuff or tamper with its bound buffers
-  glBindVertexArray(0);
+  // The VAO stays bound, the next instance's bind is then elided by GLState
 }
 
 void Cube::update() {
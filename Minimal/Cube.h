@@ -15,6 +15,8 @@
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Program.h"
+
 class Cube {
 public:
   Cube();
@@ -28,7 +30,7 @@ public:
 
   // These variables are needed for the shader program
   GLuint vertexBuffer, normalBuffer, VAO;
-  GLuint uProjection, uModelview;
+  Uniform<glm::mat4> uProjection{ "projection" }, uModelview{ "modelview" };
 };
 
 #endif
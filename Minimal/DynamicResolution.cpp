@@ -0,0 +1,78 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+// Smoothing weight of the newest measurement
+const float SMOOTHING = 0.2f;
+// Shrink above this part of the budget, aiming for the lower target, grow below the last
+const float SHRINK_ABOVE = 0.95f, SHRINK_TARGET = 0.85f, GROW_BELOW = 0.7f;
+// Scales snap to this step so small changes don't resize the viewport every frame
+const float SCALE_STEP = 0.05f;
+
+DynamicResolution::DynamicResolution(float budgetMs, float minScale, float maxScale) :
+	changes(0), next(0), budget(budgetMs), minScale(minScale), maxScale(maxScale), current(maxScale),
+	smoothedMs(0.0f), headroomFrames(0), settleFrames(0)
+{
+	glGenQueries(LATENCY, queries);
+	std::fill(pending, pending + LATENCY, false);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	glDeleteQueries(LATENCY, queries);
+}
+
+void DynamicResolution::beginFrame()
+{
+	// The query about to be reused was issued LATENCY frames ago, its result is in by now
+	if (pending[next]) {
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[next], GL_QUERY_RESULT, &nanoseconds);
+		pending[next] = false;
+		update(nanoseconds * 1e-6f);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+}
+
+void DynamicResolution::endFrame()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	pending[next] = true;
+	next = (next + 1) % LATENCY;
+}
+
+void DynamicResolution::update(float ms)
+{
+	// Frames still in flight were rendered at the old scale
+	if (settleFrames > 0) {
+		settleFrames--;
+		return;
+	}
+	smoothedMs = smoothedMs == 0.0f ? ms : smoothedMs + (ms - smoothedMs) * SMOOTHING;
+
+	float scale = current;
+	if (smoothedMs > budget * SHRINK_ABOVE) {
+		// GPU time follows the pixel count, the square of the scale
+		scale = current * std::sqrt(budget * SHRINK_TARGET / smoothedMs);
+		scale = std::floor(scale / SCALE_STEP) * SCALE_STEP;
+		headroomFrames = 0;
+	}
+	else if (smoothedMs < budget * GROW_BELOW) {
+		if (++headroomFrames >= GROW_FRAMES) {
+			scale = current + SCALE_STEP;
+			headroomFrames = 0;
+		}
+	}
+	else {
+		headroomFrames = 0;
+	}
+
+	scale = std::min(std::max(scale, minScale), maxScale);
+	if (scale != current) {
+		current = scale;
+		changes++;
+		settleFrames = SETTLE_FRAMES;
+		// The old time no longer predicts the new scale
+		smoothedMs = 0.0f;
+	}
+}
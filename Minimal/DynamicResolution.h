@@ -0,0 +1,56 @@
+#ifndef _DYNAMICRESOLUTION_H
+#define _DYNAMICRESOLUTION_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+
+// Picks the eye viewport scale from measured GPU time. Each frame's GPU work is
+// bracketed by a timer query, read back LATENCY frames later so the CPU never
+// waits on it. The scale drops as soon as the smoothed time nears the budget and
+// only creeps back up after a run of frames with clear headroom.
+class DynamicResolution
+{
+public:
+	enum {
+		// Frames between issuing a timer query and reading it
+		LATENCY = 3,
+		// Frames with headroom before the scale grows, and frames ignored after a change
+		GROW_FRAMES = 45,
+		SETTLE_FRAMES = LATENCY + 2
+	};
+
+	// budgetMs is the GPU time a frame may take, scales stay within [minScale, maxScale]
+	DynamicResolution(float budgetMs, float minScale, float maxScale = 1.0f);
+	~DynamicResolution();
+
+	// Bracket the GPU work of one frame
+	void beginFrame();
+	void endFrame();
+
+	// Viewport scale for the next frame, per axis
+	float scale() const { return current; }
+	// Smoothed GPU time per frame in milliseconds
+	float gpuMilliseconds() const { return smoothedMs; }
+
+	// Times the scale changed since startup
+	unsigned int changes;
+
+private:
+	// Fold a finished measurement in and adjust the scale
+	void update(float ms);
+
+	GLuint queries[LATENCY];
+	bool pending[LATENCY];
+	int next;
+
+	float budget, minScale, maxScale, current;
+	float smoothedMs;
+	int headroomFrames, settleFrames;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "EyeBufferConfig.h"
+#include "MultiResTarget.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+EyeBufferConfig::EyeBufferConfig() : stereo(false), lensMask(0.0f), dynamicResolution(0.0f), multiResCenter(0.0f), multiResDensity(1.0f), source("defaults")
+{
+}
+
+bool EyeBufferConfig::load(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		std::cerr << "could not open eye buffer config " << filename << ", every option is off" << std::endl;
+		return false;
+	}
+	source = filename;
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		std::istringstream in(line);
+		std::string keyword;
+		if (!(in >> keyword) || keyword[0] == '#') {
+			continue;
+		}
+
+		if (keyword == "stereo") {
+			int enabled;
+			if (!(in >> enabled)) {
+				std::cerr << "error parsing eye buffer config " << filename << " line " << lineNumber << std::endl;
+				enabled = 0;
+			}
+			stereo = enabled != 0;
+		}
+		else if (keyword == "lensmask") {
+			if (!(in >> lensMask) || (lensMask != 0.0f && lensMask < 1.0f)) {
+				std::cerr << "error parsing eye buffer config " << filename << " line " << lineNumber << ", lens mask scale is 0 or at least 1" << std::endl;
+				lensMask = 0.0f;
+			}
+		}
+		else if (keyword == "dynres") {
+			if (!(in >> dynamicResolution) || dynamicResolution < 0.0f || dynamicResolution > 1.0f) {
+				std::cerr << "error parsing eye buffer config " << filename << " line " << lineNumber << ", dynamic resolution scale is between 0 and 1" << std::endl;
+				dynamicResolution = 0.0f;
+			}
+		}
+		else if (keyword == "multires") {
+			if (!(in >> multiResCenter >> multiResDensity) || multiResCenter < 0.0f || multiResDensity <= 0.0f || multiResDensity > 1.0f) {
+				std::cerr << "error parsing eye buffer config " << filename << " line " << lineNumber << ", multires takes a center tangent and a density up to 1" << std::endl;
+				multiResCenter = 0.0f;
+				multiResDensity = 1.0f;
+			}
+		}
+		// Everything else is a Cave line
+	}
+	return true;
+}
+
+void EyeBufferConfig::resolve(bool perEyeOnly)
+{
+	// Portals stencil each eye's walls in turn and the eye buffer stand-in composites per eye.
+	// Stereo only asks for one pass where the scene allows it, so it goes without a warning.
+	if (perEyeOnly && multiRes()) {
+		std::cerr << "eye buffer config " << source << " enables multires, the scene draws each eye on its own, multires is ignored" << std::endl;
+		multiResCenter = 0.0f;
+	}
+	// Multi-resolution mode draws each eye's regions as one view set, both eyes at once isn't possible
+	if (perEyeOnly || multiRes()) {
+		stereo = false;
+	}
+}
+
+int EyeBufferConfig::viewsPerDraw() const
+{
+	return multiRes() ? MultiResTarget::REGIONS : 2;
+}
+
+std::string EyeBufferConfig::viewDefines() const
+{
+	return "#define VIEW_COUNT " + std::to_string(viewsPerDraw());
+}
@@ -0,0 +1,53 @@
+#ifndef _EYEBUFFERCONFIG_H
+#define _EYEBUFFERCONFIG_H
+
+#include <string>
+
+// How the eye buffer passes are drawn, read from the same config file as the
+// Cave walls, which skips these lines:
+// The eye buffer is drawn per eye, or both eyes in one pass where the scene allows:
+//   stereo <0 | 1>
+// Eye buffer pixels the lenses never show are masked out in depth, the lenses are
+// taken to show the ellipse touching the viewport edges grown by scale, 0 disables it:
+//   lensmask <scale>
+// The eye viewports shrink while the GPU misses the frame budget, down to min scale
+// per axis, and grow back once it has headroom. 0 keeps them at full size:
+//   dynres <min scale>
+// The eye passes render 3x3 regions, full density within center tangent of the
+// optical axis and outer density per axis beyond, 0 renders at full density.
+// Takes over from stereo:
+//   multires <center tangent> <outer density>
+// Without a config every option is off.
+struct EyeBufferConfig
+{
+	// Stereo mode, the eye buffer passes draw both eyes at once through a viewport per eye
+	bool stereo;
+	// Lens mask scale, 0 leaves the whole eye viewport shaded
+	float lensMask;
+	// Smallest dynamic eye viewport scale, 0 keeps the full size
+	float dynamicResolution;
+	// Multi-resolution eye pass, a center of 0 disables it
+	float multiResCenter, multiResDensity;
+
+	EyeBufferConfig();
+
+	// Read the eye buffer lines of a config file, false if it can't be opened
+	bool load(const char* filename);
+	// Settle the options against each other and the scene. perEyeOnly is set when the
+	// scene draws each eye on its own (portal mode, eye buffer quads), which rules out
+	// stereo and multires. Only options the config asked for are warned about.
+	void resolve(bool perEyeOnly);
+
+	bool multiRes() const { return multiResCenter > 0.0f; }
+	// Views a *_stereo.geom draw goes to, the regions of one eye in multi-resolution mode or both eyes.
+	// The programs get one invocation per view, spare invocations would only return.
+	int viewsPerDraw() const;
+	// Defines setting VIEW_COUNT to viewsPerDraw, for LoadShaders
+	std::string viewDefines() const;
+
+private:
+	// Config file the options came from, for messages
+	std::string source;
+};
+
+#endif
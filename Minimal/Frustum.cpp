@@ -0,0 +1,89 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < 6; i++) {
+		planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+Frustum::Frustum(const glm::mat4& m)
+{
+	// Rows of the column-major matrix
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	planes[LEFT] = row3 + row0;
+	planes[RIGHT] = row3 - row0;
+	planes[BOTTOM] = row3 + row1;
+	planes[TOP] = row3 - row1;
+	planes[NEAR_PLANE] = row3 + row2;
+	planes[FAR_PLANE] = row3 - row2;
+
+	// Normalize so plane distances are in world units
+	for (int i = 0; i < 6; i++) {
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+Frustum Frustum::stereo(const Frustum& left, const Frustum& right)
+{
+	Frustum result = left;
+	result.planes[RIGHT] = right.planes[RIGHT];
+	return result;
+}
+
+bool Frustum::intersects(const glm::vec4& sphere) const
+{
+	for (int i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(planes[i]), glm::vec3(sphere)) + planes[i].w < -sphere.w) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Frustum::clip(std::vector<glm::vec3>& polygon) const
+{
+	std::vector<glm::vec3> input;
+	for (int i = 0; i < 6 && !polygon.empty(); i++) {
+		input.swap(polygon);
+		polygon.clear();
+		glm::vec3 normal(planes[i]);
+		// Keep the inside part of each edge, adding the point where it crosses the plane
+		for (size_t j = 0; j < input.size(); j++) {
+			const glm::vec3& a = input[j];
+			const glm::vec3& b = input[(j + 1) % input.size()];
+			float da = glm::dot(normal, a) + planes[i].w;
+			float db = glm::dot(normal, b) + planes[i].w;
+			if (da >= 0.0f) {
+				polygon.push_back(a);
+			}
+			if ((da >= 0.0f) != (db >= 0.0f)) {
+				polygon.push_back(a + (b - a) * (da / (da - db)));
+			}
+		}
+	}
+}
+
+void cullSpheres(const Frustum* frusta, int frustumCount, const std::vector<glm::vec4>& spheres, std::vector<int>& masks)
+{
+	masks.assign(spheres.size(), 0);
+
+	// One frustum at a time over the whole batch keeps its planes in registers
+	for (int v = 0; v < frustumCount; v++) {
+		const glm::vec4* planes = frusta[v].planes;
+		for (size_t i = 0; i < spheres.size(); i++) {
+			const glm::vec4& s = spheres[i];
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				inside = planes[p].x * s.x + planes[p].y * s.y + planes[p].z * s.z + planes[p].w >= -s.w;
+			}
+			if (inside) {
+				masks[i] |= 1 << v;
+			}
+		}
+	}
+}
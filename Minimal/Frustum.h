@@ -0,0 +1,38 @@
+#ifndef _FRUSTUM_H
+#define _FRUSTUM_H
+
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+#include <vector>
+
+// Six planes of a view frustum in world space, normals point inside
+class Frustum
+{
+public:
+	enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE };
+
+	Frustum();
+	// Extract the planes of a projection * view matrix (Gribb/Hartmann)
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	// Frustum covering both eyes of an HMD. Both eyes share orientation, so only
+	// the side planes differ: the outer plane of each eye bounds the union.
+	static Frustum stereo(const Frustum& left, const Frustum& right);
+
+	// Sphere as (center, radius)
+	bool intersects(const glm::vec4& sphere) const;
+
+	// Clip a convex polygon to the frustum (Sutherland-Hodgman), empty if it lies outside
+	void clip(std::vector<glm::vec3>& polygon) const;
+
+	glm::vec4 planes[6];
+};
+
+// Test a batch of spheres against several frusta. Bit v of masks[i] is set when
+// spheres[i] touches frusta[v]; masks is resized to the sphere count.
+void cullSpheres(const Frustum* frusta, int frustumCount, const std::vector<glm::vec4>& spheres, std::vector<int>& masks);
+
+#endif
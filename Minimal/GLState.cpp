@@ -0,0 +1,296 @@
+#include "GLState.h"
+#include <array>
+#include <tuple>
+#include <utility>
+
+namespace
+{
+	GLState::Counts counts;
+
+	// One piece of shadowed state, unknown until the first call sets it
+	template <class T>
+	struct Shadow {
+		T value = T();
+		bool known = false;
+
+		// True if the call has to reach GL, the shadow then holds value
+		bool change(const T& v)
+		{
+			if (known && value == v) {
+				counts.elided++;
+				return false;
+			}
+			value = v;
+			known = true;
+			counts.issued++;
+			return true;
+		}
+	};
+
+	enum { MAX_UNITS = 16 };
+	// Texture targets the draw code binds, others go straight to GL
+	const GLenum textureTargets[] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP };
+	const int TARGETS = sizeof(textureTargets) / sizeof(textureTargets[0]);
+	// Capabilities the draw code toggles, others go straight to GL
+	const GLenum caps[] = { GL_CULL_FACE, GL_DEPTH_TEST, GL_BLEND, GL_STENCIL_TEST, GL_SCISSOR_TEST };
+	const int CAPS = sizeof(caps) / sizeof(caps[0]);
+
+	struct State {
+		Shadow<GLuint> program, vao;
+		Shadow<GLenum> unit;
+		Shadow<GLuint> textures[MAX_UNITS][TARGETS];
+		Shadow<bool> enabled[CAPS];
+		Shadow<GLenum> cullFace, depthFunc;
+		Shadow<GLboolean> depthMask;
+		Shadow<std::pair<GLenum, GLenum>> blendFunc;
+		Shadow<std::array<GLboolean, 4>> colorMask;
+		Shadow<std::tuple<GLenum, GLint, GLuint>> stencilFunc;
+		Shadow<std::tuple<GLenum, GLenum, GLenum>> stencilOp;
+		Shadow<std::pair<GLdouble, GLdouble>> depthRange;
+		Shadow<std::array<GLfloat, 4>> clearColor;
+		Shadow<GLenum> polygonMode;
+		Shadow<std::array<GLint, 4>> viewport;
+	};
+	State state;
+
+	int targetIndex(GLenum target)
+	{
+		for (int i = 0; i < TARGETS; i++) {
+			if (textureTargets[i] == target) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	int capIndex(GLenum cap)
+	{
+		for (int i = 0; i < CAPS; i++) {
+			if (caps[i] == cap) {
+				return i;
+			}
+		}
+		return -1;
+	}
+}
+
+void GLState::useProgram(GLuint program)
+{
+	if (state.program.change(program)) {
+		glUseProgram(program);
+	}
+}
+
+void GLState::bindVertexArray(GLuint vao)
+{
+	if (state.vao.change(vao)) {
+		glBindVertexArray(vao);
+	}
+}
+
+void GLState::activeTexture(GLenum unit)
+{
+	if (state.unit.change(unit)) {
+		glActiveTexture(unit);
+	}
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+	if (!state.unit.known) {
+		GLint active = GL_TEXTURE0;
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &active);
+		state.unit.value = (GLenum)active;
+		state.unit.known = true;
+	}
+	int unit = (int)(state.unit.value - GL_TEXTURE0);
+	int index = targetIndex(target);
+	if (unit >= MAX_UNITS || index < 0) {
+		counts.issued++;
+		glBindTexture(target, texture);
+		return;
+	}
+	if (state.textures[unit][index].change(texture)) {
+		glBindTexture(target, texture);
+	}
+}
+
+void GLState::enable(GLenum cap)
+{
+	int index = capIndex(cap);
+	if (index < 0) {
+		counts.issued++;
+		glEnable(cap);
+	}
+	else if (state.enabled[index].change(true)) {
+		glEnable(cap);
+	}
+}
+
+void GLState::disable(GLenum cap)
+{
+	int index = capIndex(cap);
+	if (index < 0) {
+		counts.issued++;
+		glDisable(cap);
+	}
+	else if (state.enabled[index].change(false)) {
+		glDisable(cap);
+	}
+}
+
+bool GLState::isEnabled(GLenum cap)
+{
+	int index = capIndex(cap);
+	if (index < 0) {
+		return glIsEnabled(cap) == GL_TRUE;
+	}
+	Shadow<bool>& enabled = state.enabled[index];
+	if (!enabled.known) {
+		enabled.value = glIsEnabled(cap) == GL_TRUE;
+		enabled.known = true;
+	}
+	return enabled.value;
+}
+
+void GLState::cullFace(GLenum mode)
+{
+	if (state.cullFace.change(mode)) {
+		glCullFace(mode);
+	}
+}
+
+void GLState::depthMask(GLboolean flag)
+{
+	if (state.depthMask.change(flag ? GL_TRUE : GL_FALSE)) {
+		glDepthMask(flag);
+	}
+}
+
+void GLState::depthFunc(GLenum func)
+{
+	if (state.depthFunc.change(func)) {
+		glDepthFunc(func);
+	}
+}
+
+GLenum GLState::getDepthFunc()
+{
+	if (!state.depthFunc.known) {
+		GLint func = GL_LESS;
+		glGetIntegerv(GL_DEPTH_FUNC, &func);
+		state.depthFunc.value = (GLenum)func;
+		state.depthFunc.known = true;
+	}
+	return state.depthFunc.value;
+}
+
+void GLState::blendFunc(GLenum sfactor, GLenum dfactor)
+{
+	if (state.blendFunc.change(std::make_pair(sfactor, dfactor))) {
+		glBlendFunc(sfactor, dfactor);
+	}
+}
+
+void GLState::colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+	if (state.colorMask.change({ { red, green, blue, alpha } })) {
+		glColorMask(red, green, blue, alpha);
+	}
+}
+
+void GLState::stencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+	if (state.stencilFunc.change(std::make_tuple(func, ref, mask))) {
+		glStencilFunc(func, ref, mask);
+	}
+}
+
+void GLState::stencilOp(GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+	if (state.stencilOp.change(std::make_tuple(sfail, dpfail, dppass))) {
+		glStencilOp(sfail, dpfail, dppass);
+	}
+}
+
+void GLState::depthRange(GLdouble nearVal, GLdouble farVal)
+{
+	if (state.depthRange.change(std::make_pair(nearVal, farVal))) {
+		glDepthRange(nearVal, farVal);
+	}
+}
+
+void GLState::clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	if (state.clearColor.change({ { red, green, blue, alpha } })) {
+		glClearColor(red, green, blue, alpha);
+	}
+}
+
+void GLState::polygonMode(GLenum mode)
+{
+	if (state.polygonMode.change(mode)) {
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+	}
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (state.viewport.change({ { x, y, (GLint)width, (GLint)height } })) {
+		glViewport(x, y, width, height);
+	}
+}
+
+void GLState::viewportIndexed(GLuint index, GLfloat x, GLfloat y, GLfloat width, GLfloat height)
+{
+	if (index == 0) {
+		state.viewport.known = false;
+	}
+	counts.issued++;
+	glViewportIndexedf(index, x, y, width, height);
+}
+
+void GLState::deleteProgram(GLuint program)
+{
+	// A program in use stays in use until another one replaces it
+	if (state.program.known && state.program.value == program) {
+		state.program.known = false;
+	}
+	glDeleteProgram(program);
+}
+
+void GLState::deleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+	for (GLsizei i = 0; i < n; i++) {
+		if (state.vao.known && state.vao.value == arrays[i]) {
+			state.vao.value = 0;
+		}
+	}
+	glDeleteVertexArrays(n, arrays);
+}
+
+void GLState::deleteTextures(GLsizei n, const GLuint* textures)
+{
+	for (GLsizei i = 0; i < n; i++) {
+		for (auto& unit : state.textures) {
+			for (Shadow<GLuint>& binding : unit) {
+				if (binding.known && binding.value == textures[i]) {
+					binding.value = 0;
+				}
+			}
+		}
+	}
+	glDeleteTextures(n, textures);
+}
+
+void GLState::invalidate()
+{
+	state = State();
+}
+
+GLState::Counts GLState::takeCounts()
+{
+	Counts taken = counts;
+	counts = Counts();
+	return taken;
+}
@@ -0,0 +1,65 @@
+#ifndef _GLSTATE_H
+#define _GLSTATE_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+
+// Shadow of the GL state the draw code changes: program, vertex array, texture
+// bindings, the common capabilities, depth, cull, blend, color mask, stencil
+// function and operation, clear color, polygon mode and the viewport. Every
+// change of that state goes through here, so a call that sets what is already
+// set is dropped before it reaches the driver. Calling GL directly for any of
+// it leaves the shadow stale, invalidate() makes it forget everything. Scissor
+// rectangles and framebuffer bindings aren't shadowed.
+class GLState
+{
+public:
+	// Calls passed on to GL and dropped as redundant
+	struct Counts {
+		unsigned int issued = 0;
+		unsigned int elided = 0;
+	};
+
+	static void useProgram(GLuint program);
+	static void bindVertexArray(GLuint vao);
+	// unit is GL_TEXTURE0 + i like glActiveTexture
+	static void activeTexture(GLenum unit);
+	static void bindTexture(GLenum target, GLuint texture);
+
+	static void enable(GLenum cap);
+	static void disable(GLenum cap);
+	static bool isEnabled(GLenum cap);
+	static void cullFace(GLenum mode);
+	static void depthMask(GLboolean flag);
+	static void depthFunc(GLenum func);
+	static GLenum getDepthFunc();
+	static void blendFunc(GLenum sfactor, GLenum dfactor);
+	static void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+	static void stencilFunc(GLenum func, GLint ref, GLuint mask);
+	static void stencilOp(GLenum sfail, GLenum dpfail, GLenum dppass);
+	static void depthRange(GLdouble nearVal, GLdouble farVal);
+	static void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+	// Core profiles only take GL_FRONT_AND_BACK
+	static void polygonMode(GLenum mode);
+	static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	// Not shadowed, but viewport 0 is the one glViewport sets, so it is forgotten
+	static void viewportIndexed(GLuint index, GLfloat x, GLfloat y, GLfloat width, GLfloat height);
+
+	// Deleting a bound object unbinds it, the shadow has to follow
+	static void deleteProgram(GLuint program);
+	static void deleteVertexArrays(GLsizei n, const GLuint* arrays);
+	static void deleteTextures(GLsizei n, const GLuint* textures);
+
+	// Forget the shadowed state, the next call of each kind reaches GL
+	static void invalidate();
+
+	// Counts since the last call
+	static Counts takeCounts();
+};
+
+#endif
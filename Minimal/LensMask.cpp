@@ -0,0 +1,97 @@
+#include "LensMask.h"
+#include "shader.h"
+#include "GLState.h"
+#include <glm/gtc/constants.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+LensMask::LensMask(const glm::vec4 fov[EYES], float scale)
+{
+	std::vector<glm::vec2> vertices;
+	for (int eye = 0; eye < EYES; eye++) {
+		float up = fov[eye].x, down = fov[eye].y, left = fov[eye].z, right = fov[eye].w;
+		// Tangent space to the eye's NDC, the optical axis is off center with an asymmetric field of view
+		glm::vec2 toNDCScale(2.0f / (left + right), 2.0f / (up + down));
+		glm::vec2 toNDCOffset((left - right) / (left + right), (down - up) / (up + down));
+
+		// Ring between the ellipse and the viewport edge. Every quadrant of the ellipse
+		// is scaled by that quadrant's tangents, so angle k * pi/4 of an odd k runs
+		// through a corner and the outer edge follows the viewport exactly.
+		first[eye] = (GLint)vertices.size();
+		float area = 0.0f;
+		glm::vec2 lastInner, lastOuter;
+		for (int i = 0; i <= SEGMENTS; i++) {
+			float angle = glm::two_pi<float>() * i / SEGMENTS;
+			glm::vec2 dir(std::cos(angle), std::sin(angle));
+			glm::vec2 bound(dir.x >= 0.0f ? right : left, dir.y >= 0.0f ? up : down);
+			dir *= bound * scale;
+			// Where the direction leaves the viewport, the ellipse point is clamped to it
+			glm::vec2 exit = bound / glm::max(glm::abs(dir), glm::vec2(1e-6f));
+			float t = std::min(exit.x, exit.y);
+			glm::vec2 inner = dir * std::min(t, 1.0f) * toNDCScale + toNDCOffset;
+			glm::vec2 outer = dir * t * toNDCScale + toNDCOffset;
+			if (i > 0) {
+				const glm::vec2 quad[6] = { lastInner, lastOuter, outer, outer, inner, lastInner };
+				vertices.insert(vertices.end(), quad, quad + 6);
+				for (int k = 0; k < 6; k += 3) {
+					glm::vec2 a = quad[k + 1] - quad[k], b = quad[k + 2] - quad[k];
+					area += 0.5f * std::abs(a.x * b.y - a.y * b.x);
+				}
+			}
+			lastInner = inner;
+			lastOuter = outer;
+		}
+		count[eye] = (GLsizei)vertices.size() - first[eye];
+		// NDC covers 2 by 2
+		hidden[eye] = area / 4.0f;
+	}
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	GLState::bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (GLvoid*)0);
+	GLState::bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	program = LoadShaders("lens_mask.vert", "lens_mask.frag");
+}
+
+LensMask::~LensMask()
+{
+	GLState::deleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	GLState::deleteProgram(program);
+}
+
+void LensMask::draw(int eye)
+{
+	if (count[eye] == 0) {
+		return;
+	}
+	// Depth only, written whatever is there and whichever way the triangles face
+	GLboolean depthTest = GLState::isEnabled(GL_DEPTH_TEST), cullFace = GLState::isEnabled(GL_CULL_FACE);
+	GLenum depthFunc = GLState::getDepthFunc();
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthFunc(GL_ALWAYS);
+	GLState::depthMask(GL_TRUE);
+	GLState::disable(GL_CULL_FACE);
+	GLState::colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+	GLState::useProgram(program);
+	GLState::bindVertexArray(VAO);
+	glDrawArrays(GL_TRIANGLES, first[eye], count[eye]);
+	GLState::bindVertexArray(0);
+
+	GLState::colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	GLState::depthFunc(depthFunc);
+	if (!depthTest) {
+		GLState::disable(GL_DEPTH_TEST);
+	}
+	if (cullFace) {
+		GLState::enable(GL_CULL_FACE);
+	}
+}
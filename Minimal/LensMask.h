@@ -0,0 +1,45 @@
+#ifndef _LENSMASK_H
+#define _LENSMASK_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+// Parts of each eye viewport the lenses never show. The mask is drawn into
+// depth at the near plane before anything else, so later draws over it fail
+// the depth test before they are shaded.
+class LensMask
+{
+public:
+	enum { EYES = 2, SEGMENTS = 64 };
+
+	// fov holds each eye's field of view as tangents (up, down, left, right), as
+	// in ovrFovPort. The lenses are taken to show the ellipse touching the four
+	// viewport edges, grown by scale. 1 hides the corners outside it, larger
+	// values hide less.
+	LensMask(const glm::vec4 fov[EYES], float scale);
+	~LensMask();
+
+	// Write near depth over the hidden area of eye in the current viewport
+	void draw(int eye);
+	// Fraction of eye's viewport that is hidden
+	float hiddenFraction(int eye) const { return hidden[eye]; }
+
+private:
+	GLuint VAO, VBO, program;
+	// Vertex range of each eye's triangles
+	GLint first[EYES];
+	GLsizei count[EYES];
+	float hidden[EYES];
+};
+
+#endif
@@ -1,59 +1,61 @@
 #include "Line.h"
+#include "GLState.h"
 #include <iostream>
 
-Line::Line()
+Line::Line(StreamBuffer& stream) : stream(stream), first(-1)
 {
 	toWorld = glm::mat4(1.0f);
 
 	pressed = false;
 
-	// Create array object and buffers
+	// Create array object, the vertices live in the stream buffer so the attribute is set up once
 	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
+	GLState::bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+	// Enable the usage of layout location 0 (check the vertex shader to see what this is)
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::bindVertexArray(0);
 }
 
 Line::~Line()
 {
-	// Delete previously generated buffer
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+	// Delete previously generated array object
+	GLState::deleteVertexArrays(1, &VAO);
 }
 
-void Line::draw(GLint shaderProgram, glm::mat4 Projection, glm::mat4 View) {
+void Line::draw(GLint shaderProgram) {
+
+	// Not written since the stream buffer was created
+	if (first < 0) {
+		return;
+	}
 
 	// Set Line Width
 	glLineWidth(10.0f);
 
-	GLuint uAmbient = glGetUniformLocation(shaderProgram, "material.ambient");
-	GLuint uDiffuse = glGetUniformLocation(shaderProgram, "material.diffuse");
 	if (!pressed) {
-		glUniform3f(uAmbient, 0.0f, 1.0f, 0.0f);
+		uAmbient.set(shaderProgram, glm::vec3(0.0f, 1.0f, 0.0f));
 	}
 	else {
-		glUniform3f(uAmbient, 1.0f, 0.0f, 0.0f);
+		uAmbient.set(shaderProgram, glm::vec3(1.0f, 0.0f, 0.0f));
 	}
 
 	if (!pressed) {
-		glUniform3f(uDiffuse, 0.0f, 1.0f, 0.0f);
+		uDiffuse.set(shaderProgram, glm::vec3(0.0f, 1.0f, 0.0f));
 	}
 	else {
-		glUniform3f(uDiffuse, 1.0f, 0.0f, 0.0f);
+		uDiffuse.set(shaderProgram, glm::vec3(1.0f, 0.0f, 0.0f));
 	}
 
-	uProjection = glGetUniformLocation(shaderProgram, "projection");
-	uModel = glGetUniformLocation(shaderProgram, "model");
-	uView = glGetUniformLocation(shaderProgram, "view");
 	// Now send these values to the shader program
-	glUniformMatrix4fv(uProjection, 1, GL_FALSE, &Projection[0][0]);
-	glUniformMatrix4fv(uModel, 1, GL_FALSE, &View[0][0]);
-	glUniformMatrix4fv(uView, 1, GL_FALSE, &toWorld[0][0]);
+	uView.set(shaderProgram, toWorld);
 
 	// Now draw the cube. 
-	glBindVertexArray(VAO);
+	GLState::bindVertexArray(VAO);
 	// Tell OpenGL to draw with Lines
-	glDrawArrays(GL_LINES, 0, 2);
-	// Unbind the VAO
-	glBindVertexArray(0);
+	glDrawArrays(GL_LINES, first, 2);
 }
 
 void Line::update(glm::vec3 p1, glm::vec3 p2, bool p)
@@ -70,26 +72,7 @@ void Line::update(glm::vec3 p1, glm::vec3 p2, bool p)
 	vertices[1][1] = p2.y;
 	vertices[1][2] = p2.z;
 
-	// Bind the Vertex Array Object (VAO) first
-	glBindVertexArray(VAO);
-
-	// Bind a VBO to it as a GL_ARRAY_BUFFER
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	// glBufferData populates the most recently bound buffer with data starting at the 3rd argument and ending after
-	// the 2nd argument number of indices. How does OpenGL know how long an index spans? Go to glVertexAttribPointer.
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	// Enable the usage of layout location 0 (check the vertex shader to see what this is)
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0,// This first parameter x should be the same as the number passed into the line "layout (location = x)" in the vertex shader. In this case, it's 0. Valid values are 0 to GL_MAX_UNIFORM_LOCATIONS.
-		3, // This second line tells us how any components there are per vertex. In this case, it's 3 (we have an x, y, and z component)
-		GL_FLOAT, // What type these components are
-		GL_FALSE, // GL_TRUE means the values should be normalized. GL_FALSE means they shouldn't
-		3 * sizeof(GLfloat), // Offset between consecutive indices. Since each of our vertices have 3 floats, they should have the size of 3 floats in between
-		(GLvoid*)0); // Offset of the first vertex's component. In our case it's 0 since we don't pad the vertices array with anything.
-
-	// Unbind the currently bound buffer 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	// Unbind the VAO 
-	glBindVertexArray(0);
+	// Aligned to whole vertices, so the offset is a vertex index into the stream buffer
+	GLintptr offset = stream.write(vertices, sizeof(vertices), sizeof(vertices[0]));
+	first = offset < 0 ? -1 : (GLint)(offset / sizeof(vertices[0]));
 }
-
@@ -15,20 +15,29 @@
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Program.h"
+#include "StreamBuffer.h"
+
 class Line
 {
 public:
-	Line();
+	// The end points are written to stream every update, it must outlive the line
+	Line(StreamBuffer& stream);
 	~Line();
 
 	glm::mat4 toWorld;
 
-	void draw(GLint shaderProgram, glm::mat4 Projection, glm::mat4 View);
+	// Draw through the eye of the bound PerView slot, or the views of line_stereo.geom
+	void draw(GLint shaderProgram);
 	void update(glm::vec3 p1, glm::vec3 p2, bool p);
 
 	// These variables are needed for the shader program
-	GLuint VBO, VAO;
-	GLuint uProjection, uModel, uView;
+	StreamBuffer& stream;
+	// Reads the stream buffer from offset 0, the line's vertices start at first
+	GLuint VAO;
+	GLint first;
+	Uniform<glm::mat4> uView{ "view" };
+	Uniform<glm::vec3> uAmbient{ "material.ambient" }, uDiffuse{ "material.diffuse" };
 
 	bool pressed;
 	
@@ -8,6 +8,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shader.h"
+#include "Program.h"
+#include "GLState.h"
 
 #include <string>
 #include <fstream>
@@ -42,7 +44,9 @@ public:
     vector<unsigned int> indices;
     vector<Texture> textures;
     unsigned int VAO;
-	GLuint uProjection, uModelview;
+	Uniform<glm::mat4> uProjection{ "projection" }, uModelview{ "modelview" };
+	// Sampler of each texture, named by its type and number (the N in diffuse_textureN)
+	vector<Uniform<GLint>> samplers;
 
     /*  Functions  */
     // constructor
@@ -52,24 +56,14 @@ public:
         this->indices = indices;
         this->textures = textures;
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
-    }
-
-    // render the mesh
-    void Draw(GLuint shaderProgram, const glm::mat4& projection, const glm::mat4& view, glm::mat4 toWorld)
-    {
-        // bind appropriate textures
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        for(const Texture& texture : textures)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
             string number;
-            string name = textures[i].type;
+            string name = texture.type;
             if(name == "texture_diffuse")
 				number = std::to_string(diffuseNr++);
 			else if(name == "texture_specular")
@@ -78,27 +72,37 @@ public:
 				number = std::to_string(normalNr++); // transfer unsigned int to stream
              else if(name == "texture_height")
 			    number = std::to_string(heightNr++); // transfer unsigned int to stream
+            samplers.push_back(Uniform<GLint>(name + number));
+        }
 
-													 // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shaderProgram, (name + number).c_str()), i);
+        // now that we have all the required data, set the vertex buffers and its attribute pointers.
+        setupMesh();
+    }
+
+    // render the mesh
+    void Draw(GLuint shaderProgram, const glm::mat4& projection, const glm::mat4& view, glm::mat4 toWorld)
+    {
+		GLState::useProgram(shaderProgram);
+        // bind appropriate textures
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            GLState::activeTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            samplers[i].set(shaderProgram, (GLint)i);
             // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            GLState::bindTexture(GL_TEXTURE_2D, textures[i].id);
         }
-		glUseProgram(shaderProgram);
 		glm::mat4 modelview = view * toWorld;
-		uProjection = glGetUniformLocation(shaderProgram, "projection");
-		uModelview = glGetUniformLocation(shaderProgram, "modelview");
 		// Now send these values to the shader program
-		glUniformMatrix4fv(uProjection, 1, GL_FALSE, &projection[0][0]);
-		glUniformMatrix4fv(uModelview, 1, GL_FALSE, &modelview[0][0]);
+		uProjection.set(shaderProgram, projection);
+		uModelview.set(shaderProgram, modelview);
         
         // draw mesh
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
 		
         // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        GLState::activeTexture(GL_TEXTURE0);
     }
 
 private:
@@ -115,7 +119,7 @@ private:
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
@@ -143,7 +147,7 @@ private:
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 
-        glBindVertexArray(0);
+        GLState::bindVertexArray(0);
     }
 	
 };
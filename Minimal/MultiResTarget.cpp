@@ -0,0 +1,189 @@
+#include "MultiResTarget.h"
+#include "shader.h"
+#include "Program.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+	// multires.frag
+	const Uniform<glm::vec2> uEyeOrigin("eyeOrigin"), uEyeSize("eyeSize"), uSplit("split");
+	const Uniform<glm::vec2> uViewportOrigin("viewportOrigin"), uViewportSize("viewportSize");
+	const Uniform<glm::vec2> uRegionMin("regionMin"), uRegionMax("regionMax"), uImageSize("imageSize");
+	const Uniform<GLint> uImage("image");
+}
+
+MultiResTarget::MultiResTarget(const glm::vec4 fov[EYES], const glm::ivec2& maxSize, float centerTangent, float outerDensity) :
+	currentEye(0), maxSize(maxSize), currentSize(maxSize), textureSize(0)
+{
+	for (int eye = 0; eye < EYES; eye++) {
+		// (low, high) tangents of x and y, the optical axis is off center with an asymmetric field of view
+		const glm::vec2 range[2] = { glm::vec2(fov[eye].z, fov[eye].w), glm::vec2(fov[eye].y, fov[eye].x) };
+		for (int a = 0; a < 2; a++) {
+			Axis& axis = axes[eye][a];
+			float low = range[a].x, high = range[a].y;
+			axis.split[0] = -1.0f;
+			axis.split[1] = glm::clamp((low - centerTangent) / (low + high) * 2.0f - 1.0f, -1.0f, 1.0f);
+			axis.split[2] = glm::clamp((low + centerTangent) / (low + high) * 2.0f - 1.0f, -1.0f, 1.0f);
+			axis.split[3] = 1.0f;
+			axis.density[0] = axis.density[2] = outerDensity;
+			axis.density[1] = 1.0f;
+
+			// The packed texture fits the largest viewport of either eye
+			layout(axis, maxSize[a]);
+			textureSize[a] = std::max(textureSize[a], axis.offset[2] + axis.length[2]);
+		}
+	}
+
+	glGenTextures(1, &colorTexture);
+	GLState::bindTexture(GL_TEXTURE_2D, colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureSize.x, textureSize.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GLState::bindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, textureSize.x, textureSize.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "multi-resolution framebuffer incomplete" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	program = LoadShaders("multires.vert", "multires.frag");
+	// multires.vert makes a full viewport triangle from gl_VertexID, but core profile draws need a VAO
+	glGenVertexArrays(1, &VAO);
+}
+
+MultiResTarget::~MultiResTarget()
+{
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteRenderbuffers(1, &depthBuffer);
+	GLState::deleteTextures(1, &colorTexture);
+	GLState::deleteVertexArrays(1, &VAO);
+	GLState::deleteProgram(program);
+}
+
+void MultiResTarget::layout(Axis& axis, int size) const
+{
+	int offset = 0;
+	for (int k = 0; k < 3; k++) {
+		float extent = (axis.split[k + 1] - axis.split[k]) * 0.5f;
+		axis.offset[k] = offset;
+		axis.length[k] = std::max(0, (int)std::ceil(axis.density[k] * extent * size));
+		axis.viewportSize[k] = axis.density[k] * size;
+		axis.viewportOrigin[k] = offset - axis.density[k] * (axis.split[k] + 1.0f) * 0.5f * size;
+		offset += axis.length[k];
+	}
+}
+
+void MultiResTarget::bind(int eye, const glm::ivec2& size)
+{
+	currentEye = eye;
+	currentSize = size;
+	for (int a = 0; a < 2; a++) {
+		layout(axes[eye][a], size[a]);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	GLState::disable(GL_SCISSOR_TEST);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	useRegions();
+}
+
+void MultiResTarget::setViewport(int index, int region)
+{
+	const Axis& x = axes[currentEye][0];
+	const Axis& y = axes[currentEye][1];
+	int column = region % 3, row = region / 3;
+	GLState::viewportIndexed(index, x.viewportOrigin[column], y.viewportOrigin[row], x.viewportSize[column], y.viewportSize[row]);
+	glScissorIndexed(index, x.offset[column], y.offset[row], x.length[column], y.length[row]);
+}
+
+void MultiResTarget::useRegion(int region)
+{
+	setViewport(0, region);
+	GLState::enable(GL_SCISSOR_TEST);
+}
+
+void MultiResTarget::useRegions()
+{
+	for (int i = 0; i < REGIONS; i++) {
+		setViewport(i, i);
+	}
+	GLState::enable(GL_SCISSOR_TEST);
+}
+
+glm::vec4 MultiResTarget::regionRect(int eye, int region) const
+{
+	const Axis& x = axes[eye][0];
+	const Axis& y = axes[eye][1];
+	int column = region % 3, row = region / 3;
+	return glm::vec4(x.split[column], y.split[row], x.split[column + 1], y.split[row + 1]);
+}
+
+void MultiResTarget::composite(const glm::ivec2& origin)
+{
+	const Axis& x = axes[currentEye][0];
+	const Axis& y = axes[currentEye][1];
+	glm::vec2 split[2], viewportOrigin[3], viewportSize[3], regionMin[3], regionMax[3];
+	for (int k = 0; k < 3; k++) {
+		viewportOrigin[k] = glm::vec2(x.viewportOrigin[k], y.viewportOrigin[k]);
+		viewportSize[k] = glm::vec2(x.viewportSize[k], y.viewportSize[k]);
+		regionMin[k] = glm::vec2((float)x.offset[k], (float)y.offset[k]);
+		regionMax[k] = glm::vec2((float)(x.offset[k] + x.length[k]), (float)(y.offset[k] + y.length[k]));
+	}
+	split[0] = glm::vec2(x.split[1], y.split[1]);
+	split[1] = glm::vec2(x.split[2], y.split[2]);
+
+	GLState::useProgram(program);
+	uEyeOrigin.set(program, glm::vec2(origin));
+	uEyeSize.set(program, glm::vec2(currentSize));
+	uSplit.set(program, split, 2);
+	uViewportOrigin.set(program, viewportOrigin, 3);
+	uViewportSize.set(program, viewportSize, 3);
+	uRegionMin.set(program, regionMin, 3);
+	uRegionMax.set(program, regionMax, 3);
+	uImageSize.set(program, glm::vec2(textureSize));
+	uImage.set(program, 0);
+
+	// Every eye pixel is written once, alpha included for the quad layers underneath
+	GLboolean depthTest = GLState::isEnabled(GL_DEPTH_TEST), cullFace = GLState::isEnabled(GL_CULL_FACE);
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::disable(GL_CULL_FACE);
+	GLState::disable(GL_SCISSOR_TEST);
+
+	GLState::activeTexture(GL_TEXTURE0);
+	GLState::bindTexture(GL_TEXTURE_2D, colorTexture);
+	GLState::bindVertexArray(VAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	GLState::bindVertexArray(0);
+	GLState::bindTexture(GL_TEXTURE_2D, 0);
+
+	if (depthTest) {
+		GLState::enable(GL_DEPTH_TEST);
+	}
+	if (cullFace) {
+		GLState::enable(GL_CULL_FACE);
+	}
+}
+
+float MultiResTarget::shadedFraction(int eye) const
+{
+	// At the full viewport size, smaller viewports only differ by rounding
+	Axis x = axes[eye][0], y = axes[eye][1];
+	layout(x, maxSize.x);
+	layout(y, maxSize.y);
+	float shaded = (float)(x.offset[2] + x.length[2]) * (y.offset[2] + y.length[2]);
+	return shaded / ((float)maxSize.x * maxSize.y);
+}
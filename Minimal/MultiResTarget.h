@@ -0,0 +1,72 @@
+#ifndef _MULTIRESTARGET_H
+#define _MULTIRESTARGET_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+// Offscreen target of the multi-resolution eye pass. Each eye viewport is split
+// into 3x3 regions at the tangents -center and +center of its field of view.
+// The center region is rendered at full density and the outer ring at a lower
+// one, the lenses compress the periphery anyway. Region i is drawn through
+// viewport i into its own rectangle of one packed texture, composite then
+// upsamples the regions into the eye buffer.
+class MultiResTarget
+{
+public:
+	enum { EYES = 2, REGIONS = 9 };
+
+	// fov holds each eye's field of view as tangents (up, down, left, right), as in
+	// ovrFovPort. maxSize is the largest eye viewport, outerDensity the fraction of
+	// full density per axis the outer regions get.
+	MultiResTarget(const glm::vec4 fov[EYES], const glm::ivec2& maxSize, float centerTangent, float outerDensity);
+	~MultiResTarget();
+
+	// Start eye's pass for an eye viewport of size: bind and clear the target, and
+	// make viewport and scissor rectangle i those of region i
+	void bind(int eye, const glm::ivec2& size);
+	// Make region i viewport 0, for draws that don't go through the view geometry
+	// shaders, and put all regions back
+	void useRegion(int region);
+	void useRegions();
+	// Part of eye's NDC region i covers, (x0, y0, x1, y1)
+	glm::vec4 regionRect(int eye, int region) const;
+
+	// Upsample the last pass into the eye viewport at origin of the bound framebuffer
+	void composite(const glm::ivec2& origin);
+
+	// Fraction of the eye viewport's pixels a pass of eye shades
+	float shadedFraction(int eye) const;
+
+private:
+	// Regions along one axis of an eye, low, center and high
+	struct Axis {
+		// NDC boundaries of the regions
+		float split[4];
+		float density[3];
+		// Pixels of the packed texture each region uses
+		int offset[3], length[3];
+		// Viewport that maps the whole NDC range so the region's part lands there
+		float viewportOrigin[3], viewportSize[3];
+	};
+	void layout(Axis& axis, int size) const;
+	void setViewport(int index, int region);
+
+	Axis axes[EYES][2];
+	int currentEye;
+	glm::ivec2 maxSize, currentSize, textureSize;
+
+	GLuint FBO, colorTexture, depthBuffer;
+	GLuint program, VAO;
+};
+
+#endif
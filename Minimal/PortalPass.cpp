@@ -0,0 +1,123 @@
+#include "PortalPass.h"
+#include "ViewBlock.h"
+#include "shader.h"
+#include "GLState.h"
+#include <iostream>
+
+PortalPass::PortalPass(Cave& cave, WallStats& stats) : cave(cave), stats(stats)
+{
+	for (int eye = 0; eye < EYES; eye++) {
+		portalMask[eye] = litMask[eye] = 0;
+	}
+	program = LoadShaders("portal.vert", "portal.frag");
+	depthProgram = LoadShaders("wall_depth.vert", "lens_mask.frag");
+	ViewBlock::attach(depthProgram);
+	std::cout << "wall targets: none, " << cave.wallCount() << " walls in portal mode" << std::endl;
+}
+
+void PortalPass::prepare(int eye, const glm::mat4& wallView, int visibleMask, int lit)
+{
+	wallViews[eye] = wallView;
+	portalMask[eye] = visibleMask;
+	litMask[eye] = lit;
+}
+
+void PortalPass::submit(RenderQueue& queue, int eye, const glm::mat4& projection, const glm::mat4& modelview,
+	const glm::mat4* wallProjections, WallContent& content)
+{
+	queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, depthProgram, 0, 0.0f), [this, eye, projection, modelview, wallProjections, &content] {
+		render(eye, projection, modelview, wallProjections, content);
+	});
+}
+
+void PortalPass::render(int eye, const glm::mat4& projection, const glm::mat4& modelview, const glm::mat4* wallProjections, WallContent& content)
+{
+	const std::vector<Cave::Wall>& caveWalls = cave.getWalls();
+	int wallCount = cave.wallCount();
+	const glm::mat4& wallView = wallViews[eye];
+	glm::mat4 eyeViewProjection = projection * modelview;
+
+	// The walls each cube instance falls into, as in the wall pass
+	Frustum wallFrusta[Cave::MAX_WALLS];
+	for (int i = 0; i < wallCount; i++) {
+		wallFrusta[i] = Frustum(wallProjections[i] * wallView);
+	}
+	content.cull(wallFrusta, wallCount);
+
+	GLState::enable(GL_STENCIL_TEST);
+	for (int i = 0; i < wallCount; i++) {
+		if ((portalMask[eye] & (1 << i)) == 0) {
+			continue;
+		}
+		GLint ref = i + 1;
+
+		// Mark the pixels of the wall that aren't hidden, only stencil and depth are written
+		GLState::useProgram(depthProgram);
+		GLState::colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		GLState::depthMask(GL_FALSE);
+		GLState::stencilFunc(GL_ALWAYS, ref, 0xFF);
+		GLState::stencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+		cave.drawWall(depthProgram, i);
+
+		// Reset their depth, the scene behind the wall brings its own
+		GLState::stencilFunc(GL_EQUAL, ref, 0xFF);
+		GLState::stencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+		GLState::depthMask(GL_TRUE);
+		GLState::depthFunc(GL_ALWAYS);
+		GLState::depthRange(1.0, 1.0);
+		cave.drawWall(depthProgram, i);
+		GLState::depthRange(0.0, 1.0);
+		GLState::depthFunc(GL_LEQUAL);
+
+		// The scene through the wall
+		GLState::colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		draw(portalMatrix(eyeViewProjection, caveWalls[i]), wallProjections[i], wallView, i, (litMask[eye] & (1 << i)) != 0,
+			*content.skyboxes[eye], content);
+
+		// Put the wall's own depth back for the lines and cursors
+		GLState::colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		GLState::useProgram(depthProgram);
+		GLState::depthFunc(GL_ALWAYS);
+		cave.drawWall(depthProgram, i);
+		GLState::depthFunc(GL_LEQUAL);
+		GLState::colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		stats.wallsRendered++;
+	}
+	GLState::disable(GL_STENCIL_TEST);
+}
+
+void PortalPass::draw(const glm::mat4& portal, const glm::mat4& wallProjection, const glm::mat4& wallView, int wall, bool lit,
+	Skybox& skybox, WallContent& content)
+{
+	GLState::useProgram(program);
+	uPortalMatrix.set(program, portal);
+	uPortalProjection.set(program, wallProjection);
+	uPortalLit.set(program, lit ? 1 : 0);
+	for (int i = 0; i < 6; i++) {
+		GLState::enable(GL_CLIP_DISTANCE0 + i);
+	}
+
+	skybox.draw(program, wallView);
+	for (size_t i = 0; lit && i < content.count(); i++) {
+		if ((content.wallMasks[i] & (1 << wall)) == 0) {
+			stats.instancesCulled++;
+			continue;
+		}
+		content.cube->toWorld = content.toWorld(i);
+		content.cube->draw(program, wallView);
+		stats.instancesDrawn++;
+	}
+
+	for (int i = 0; i < 6; i++) {
+		GLState::disable(GL_CLIP_DISTANCE0 + i);
+	}
+}
+
+glm::mat4 PortalPass::portalMatrix(const glm::mat4& eyeViewProjection, const Cave::Wall& wall)
+{
+	glm::vec3 halfRight = (wall.pb - wall.pa) * 0.5f;
+	glm::vec3 halfUp = (wall.pc - wall.pa) * 0.5f;
+	glm::vec3 center = wall.pa + halfRight + halfUp;
+	return glm::mat4(eyeViewProjection * glm::vec4(halfRight, 0.0f), eyeViewProjection * glm::vec4(halfUp, 0.0f),
+		glm::vec4(0.0f), eyeViewProjection * glm::vec4(center, 1.0f));
+}
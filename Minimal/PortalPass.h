@@ -0,0 +1,63 @@
+#ifndef _PORTALPASS_H
+#define _PORTALPASS_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "Cave.h"
+#include "WallContent.h"
+#include "WallStats.h"
+#include "RenderQueue.h"
+#include "Program.h"
+
+// Portal mode: each visible wall is stencil masked in the eye buffer and the
+// scene is drawn into it through the wall's off-axis projection, so there is
+// no wall image to resample.
+class PortalPass
+{
+public:
+	enum { EYES = 2 };
+
+	PortalPass(Cave& cave, WallStats& stats);
+
+	// Before eye's pass: the view the walls see the scene with, the walls the eye sees and the lit ones
+	void prepare(int eye, const glm::mat4& wallView, int visibleMask, int lit);
+	// Queue the walls of eye's pass. The stencil, depth and portal draws of each wall must
+	// run in sequence, they stay one packet. wallProjections must live until the queue runs.
+	void submit(RenderQueue& queue, int eye, const glm::mat4& projection, const glm::mat4& modelview,
+		const glm::mat4* wallProjections, WallContent& content);
+
+private:
+	void render(int eye, const glm::mat4& projection, const glm::mat4& modelview, const glm::mat4* wallProjections, WallContent& content);
+	// Draw the skybox and the cubes of wall i through its portal. An unlit wall only gets a black skybox.
+	void draw(const glm::mat4& portal, const glm::mat4& wallProjection, const glm::mat4& wallView, int wall, bool lit,
+		Skybox& skybox, WallContent& content);
+	// Maps wall clip space onto the wall as the eye sees it, the wall's clip square (x, y) in [-1, 1]
+	// lands on center + x * halfRight + y * halfUp. Wall depth is dropped, portal.frag writes it.
+	static glm::mat4 portalMatrix(const glm::mat4& eyeViewProjection, const Cave::Wall& wall);
+
+	Cave& cave;
+	WallStats& stats;
+
+	// Per eye the view the walls see the scene with, the walls to draw and the walls whose projector is on
+	glm::mat4 wallViews[EYES];
+	int portalMask[EYES], litMask[EYES];
+
+	GLuint program;
+	// Position only program for the stencil and depth passes over the walls, no color is written there
+	GLuint depthProgram;
+	Uniform<glm::mat4> uPortalMatrix{ "portalMatrix" }, uPortalProjection{ "wallProjection" };
+	Uniform<GLint> uPortalLit{ "lit" };
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "Program.h"
+#include <iostream>
+#include <set>
+
+namespace
+{
+	// Programs are only deleted at shutdown, so an id is never reused for another program
+	std::unordered_map<GLuint, Program>& registry()
+	{
+		static std::unordered_map<GLuint, Program> programs;
+		return programs;
+	}
+}
+
+void Program::reflect(GLuint id)
+{
+	Program& program = registry()[id];
+	program.uniforms.clear();
+
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<GLchar> buffer(maxLength + 1);
+	for (GLint i = 0; i < count; i++) {
+		GLsizei length = 0;
+		Info info;
+		glGetActiveUniform(id, i, (GLsizei)buffer.size(), &length, &info.size, &info.type, &buffer[0]);
+		std::string name(&buffer[0], length);
+		info.location = glGetUniformLocation(id, name.c_str());
+		// Members of uniform blocks have no location
+		if (info.location < 0) {
+			continue;
+		}
+		// Arrays are reported as their first element
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+			name.erase(name.size() - 3);
+		}
+		program.uniforms[name] = info;
+	}
+}
+
+GLint Program::resolve(GLuint id, const std::string& name, GLenum type)
+{
+	auto found = registry().find(id);
+	if (found == registry().end()) {
+		// Not linked by LoadShaders, reflect it now
+		reflect(id);
+		found = registry().find(id);
+	}
+
+	const Info* info = found->second.uniform(name);
+	if (!info) {
+		// Unused uniforms are optimized away, setting location -1 is ignored
+		return -1;
+	}
+	// Samplers and bools are set as ints
+	bool matches = info->type == type || (type == GL_INT && (info->type == GL_BOOL || isSampler(info->type)));
+	if (!matches) {
+		static std::set<std::pair<GLuint, std::string>> warned;
+		if (warned.insert(std::make_pair(id, name)).second) {
+			std::cerr << "uniform " << name << " of program " << id << " has type 0x" << std::hex << info->type
+				<< ", set as 0x" << type << std::dec << std::endl;
+		}
+	}
+	return info->location;
+}
+
+const Program::Info* Program::uniform(const std::string& name) const
+{
+	auto found = uniforms.find(name);
+	return found == uniforms.end() ? nullptr : &found->second;
+}
+
+bool Program::isSampler(GLenum type)
+{
+	switch (type) {
+	case GL_SAMPLER_1D:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_3D:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_2D_ARRAY:
+	case GL_SAMPLER_2D_ARRAY_SHADOW:
+	case GL_SAMPLER_2D_MULTISAMPLE:
+	case GL_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_2D:
+	case GL_UNSIGNED_INT_SAMPLER_2D:
+		return true;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,97 @@
+#ifndef _PROGRAM_H
+#define _PROGRAM_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Active uniforms of a linked program, reflected once when LoadShaders links
+// it. Draw code doesn't look uniforms up by name per frame, it keeps Uniform
+// handles that resolve their location through this reflection the first time
+// they meet a program.
+class Program
+{
+public:
+	struct Info {
+		GLint location;
+		GLenum type;
+		// Array length, 1 for a plain uniform
+		GLint size;
+	};
+
+	// Reflect a linked program, a program linked again under the same id replaces its entry.
+	static void reflect(GLuint id);
+	// Location of the uniform name in program id, -1 if it isn't active. Warns
+	// once per uniform if its reflected type doesn't match type.
+	static GLint resolve(GLuint id, const std::string& name, GLenum type);
+
+	// Active uniform name, arrays without their "[0]", nullptr if there is none
+	const Info* uniform(const std::string& name) const;
+
+	static bool isSampler(GLenum type);
+
+private:
+	std::unordered_map<std::string, Info> uniforms;
+};
+
+// GL uniform type a C++ value is uploaded as
+inline GLenum uniformType(const GLint*) { return GL_INT; }
+inline GLenum uniformType(const GLfloat*) { return GL_FLOAT; }
+inline GLenum uniformType(const glm::vec2*) { return GL_FLOAT_VEC2; }
+inline GLenum uniformType(const glm::vec3*) { return GL_FLOAT_VEC3; }
+inline GLenum uniformType(const glm::vec4*) { return GL_FLOAT_VEC4; }
+inline GLenum uniformType(const glm::mat3*) { return GL_FLOAT_MAT3; }
+inline GLenum uniformType(const glm::mat4*) { return GL_FLOAT_MAT4; }
+
+inline void uniformValues(GLint location, const GLint* values, GLsizei count) { glUniform1iv(location, count, values); }
+inline void uniformValues(GLint location, const GLfloat* values, GLsizei count) { glUniform1fv(location, count, values); }
+inline void uniformValues(GLint location, const glm::vec2* values, GLsizei count) { glUniform2fv(location, count, &values[0][0]); }
+inline void uniformValues(GLint location, const glm::vec3* values, GLsizei count) { glUniform3fv(location, count, &values[0][0]); }
+inline void uniformValues(GLint location, const glm::vec4* values, GLsizei count) { glUniform4fv(location, count, &values[0][0]); }
+inline void uniformValues(GLint location, const glm::mat3* values, GLsizei count) { glUniformMatrix3fv(location, count, GL_FALSE, &values[0][0][0]); }
+inline void uniformValues(GLint location, const glm::mat4* values, GLsizei count) { glUniformMatrix4fv(location, count, GL_FALSE, &values[0][0][0]); }
+
+// Uniform of type T looked up by name. The location is kept per program, a
+// handle shared by a few programs finds it with a short scan. Values go to
+// the program currently in use, set takes it to pick the location.
+template <class T>
+class Uniform
+{
+public:
+	explicit Uniform(const std::string& name) : name(name) {}
+
+	GLint location(GLuint program) const
+	{
+		for (const auto& entry : locations) {
+			if (entry.first == program) {
+				return entry.second;
+			}
+		}
+		GLint location = Program::resolve(program, name, uniformType((const T*)nullptr));
+		locations.push_back(std::make_pair(program, location));
+		return location;
+	}
+
+	void set(GLuint program, const T& value) const { uniformValues(location(program), &value, 1); }
+	void set(GLuint program, const T* values, GLsizei count) const { uniformValues(location(program), values, count); }
+
+private:
+	std::string name;
+	mutable std::vector<std::pair<GLuint, GLint>> locations;
+};
+
+#endif
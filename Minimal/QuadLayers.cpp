@@ -0,0 +1,114 @@
+#include "QuadLayers.h"
+#include "shader.h"
+#include "Program.h"
+#include "GLState.h"
+#include <iostream>
+
+namespace
+{
+	// quad.vert and quad.frag
+	const Uniform<glm::mat4> uViewProjection("viewProjection"), uPose("pose");
+	const Uniform<glm::vec2> uSize("size"), uUVScale("uvScale");
+	const Uniform<GLint> uImage("image");
+}
+
+QuadLayers::QuadLayers(int count, GLsizei size) : quadCount(count), size(size)
+{
+	glGenFramebuffers(1, &drawFBO);
+}
+
+QuadLayers::~QuadLayers()
+{
+	glDeleteFramebuffers(1, &drawFBO);
+}
+
+void QuadLayers::update(const WallTarget& source, int mask, const Placement* placements)
+{
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+	for (int i = 0; i < quadCount && i < source.layers; i++) {
+		if ((mask & (1 << i)) == 0) {
+			continue;
+		}
+		// Same texel layout on both sides, the blit only copies the used extent
+		glm::ivec2 extent = glm::min(placements[i].extent, glm::ivec2(size));
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, source.layerFBO[i]);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture(i), 0);
+		glBlitFramebuffer(0, 0, extent.x, extent.y, 0, 0, extent.x, extent.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+		commit(i, placements[i]);
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+EyeBufferQuadLayers::EyeBufferQuadLayers(int count, GLsizei size) :
+	QuadLayers(count, size), textures(count), placements(count), committed(count, false)
+{
+	glGenTextures(count, &textures[0]);
+	for (GLuint texture : textures) {
+		GLState::bindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	GLState::bindTexture(GL_TEXTURE_2D, 0);
+
+	program = LoadShaders("quad.vert", "quad.frag");
+	// quad.vert makes its corners from gl_VertexID, but core profile draws need a VAO
+	glGenVertexArrays(1, &VAO);
+}
+
+EyeBufferQuadLayers::~EyeBufferQuadLayers()
+{
+	GLState::deleteTextures(quadCount, &textures[0]);
+	GLState::deleteVertexArrays(1, &VAO);
+	GLState::deleteProgram(program);
+}
+
+void EyeBufferQuadLayers::commit(int quad, const Placement& placement)
+{
+	placements[quad] = placement;
+	committed[quad] = true;
+}
+
+void EyeBufferQuadLayers::composite(const glm::mat4& viewProjection)
+{
+	GLState::useProgram(program);
+	uViewProjection.set(program, viewProjection);
+	uImage.set(program, 0);
+
+	// Layers are composited back to front with premultiplied alpha, drawing under
+	// the eye buffer weighs the quads by what its alpha leaves uncovered
+	GLboolean depthTest = GLState::isEnabled(GL_DEPTH_TEST), cullFace = GLState::isEnabled(GL_CULL_FACE);
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::disable(GL_CULL_FACE);
+	GLState::enable(GL_BLEND);
+	GLState::blendFunc(GL_ONE_MINUS_DST_ALPHA, GL_ONE);
+
+	GLState::activeTexture(GL_TEXTURE0);
+	GLState::bindVertexArray(VAO);
+	for (int i = 0; i < quadCount; i++) {
+		if (!committed[i]) {
+			continue;
+		}
+		const Placement& placement = placements[i];
+		glm::vec2 uvScale = glm::vec2(placement.extent) / (float)size;
+		uPose.set(program, placement.pose);
+		uSize.set(program, placement.size);
+		uUVScale.set(program, uvScale);
+		GLState::bindTexture(GL_TEXTURE_2D, textures[i]);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+	GLState::bindVertexArray(0);
+	GLState::bindTexture(GL_TEXTURE_2D, 0);
+
+	GLState::disable(GL_BLEND);
+	if (depthTest) {
+		GLState::enable(GL_DEPTH_TEST);
+	}
+	if (cullFace) {
+		GLState::enable(GL_CULL_FACE);
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef _QUADLAYERS_H
+#define _QUADLAYERS_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "WallTarget.h"
+#include <vector>
+
+// CAVE walls handed to the compositor as quad layers instead of being drawn
+// into the eye buffer. A quad holds a single image shown to both eyes and is
+// resampled by the compositor at display resolution. Quad i is wall i.
+class QuadLayers
+{
+public:
+	// Where a quad image shows up, in tracking space
+	struct Placement {
+		// Center and orientation, the image spans local x and y and faces +z
+		glm::mat4 pose;
+		// Width and height in meters
+		glm::vec2 size;
+		// Lower left part of the image in use
+		glm::ivec2 extent;
+	};
+
+	QuadLayers(int count, GLsizei size);
+	virtual ~QuadLayers();
+
+	int count() const { return quadCount; }
+
+	// Texture the next image of quad i is written to
+	virtual GLuint texture(int quad) = 0;
+	// Finish the image of quad i and show it at placement from now on
+	virtual void commit(int quad, const Placement& placement) = 0;
+
+	// Copy layer i of source into quad i for the walls in mask and commit them
+	void update(const WallTarget& source, int mask, const Placement* placements);
+
+protected:
+	int quadCount;
+	GLsizei size;
+
+private:
+	GLuint drawFBO;
+};
+
+// Stand-in for the SDK quad layers, keeps the quads in plain textures and
+// composites them into the eye buffer itself. The app still runs in an HMD
+// session, only the compositor's layer support is left out.
+class EyeBufferQuadLayers : public QuadLayers
+{
+public:
+	EyeBufferQuadLayers(int count, GLsizei size);
+	~EyeBufferQuadLayers();
+
+	GLuint texture(int quad) override { return textures[quad]; }
+	void commit(int quad, const Placement& placement) override;
+
+	// Draw the committed quads behind the content of the bound framebuffer, where
+	// its alpha lets them through, as seen with viewProjection
+	void composite(const glm::mat4& viewProjection);
+
+private:
+	std::vector<GLuint> textures;
+	std::vector<Placement> placements;
+	std::vector<bool> committed;
+	GLuint program, VAO;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "QuadWallPass.h"
+#include "WallView.h"
+#include "GLState.h"
+
+QuadWallPass::QuadWallPass(Cave& cave, ViewBlock& viewBlock, int firstSlot, WallStats& stats, float nearPlane, float farPlane) :
+	cave(cave), nearPlane(nearPlane), farPlane(farPlane), images(cave, viewBlock, firstSlot, stats, true, nearPlane, farPlane),
+	leftWallMask(0), leftVisibleMask(0)
+{
+	if (cave.quads == Cave::QUADS_EYE_BUFFER) {
+		layers = std::make_unique<EyeBufferQuadLayers>(cave.wallCount(), imageSize());
+	}
+}
+
+void QuadWallPass::render(int eye, const glm::mat4& modelview, const glm::mat4& hmdView, const glm::vec3& eyePos,
+	int wallMask, int visibleMask, std::vector<glm::ivec2>& extent, WallContent& content)
+{
+	if (eye == 0) {
+		leftView = modelview;
+		leftEyePos = eyePos;
+		leftWallMask = wallMask;
+		leftVisibleMask = visibleMask;
+		leftExtent = extent;
+		return;
+	}
+
+	// The eye views only differ by a translation, their mean is the view from the midpoint.
+	// A wall is lit only while both of its projectors are on.
+	const std::vector<Cave::Wall>& caveWalls = cave.getWalls();
+	glm::mat4 centerView = (leftView + modelview) * 0.5f;
+	glm::vec3 centerPos = (leftEyePos + eyePos) * 0.5f;
+	for (int i = 0; i < cave.wallCount(); i++) {
+		extent[i] = glm::max(extent[i], leftExtent[i]);
+	}
+
+	// The mono pass uses the left eye's slots and skybox
+	glm::mat4 centerProjections[Cave::MAX_WALLS];
+	for (int i = 0; i < cave.wallCount(); i++) {
+		centerProjections[i] = WallView::projection(centerPos, caveWalls[i], nearPlane, farPlane);
+	}
+	std::vector<glm::vec4> visible(extent.size(), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+	int refreshMask = images.render(0, centerView, hmdView, centerPos, centerProjections, wallMask & leftWallMask,
+		visibleMask | leftVisibleMask, extent, visible, content);
+	if (refreshMask != 0 && layers) {
+		const WallTarget& target = images.current(0);
+		QuadLayers::Placement placements[Cave::MAX_WALLS];
+		for (int i = 0; i < cave.wallCount(); i++) {
+			placements[i] = placement(caveWalls[i], target.extent[i]);
+		}
+		layers->update(target, refreshMask, placements);
+		images.fence(0);
+	}
+}
+
+void QuadWallPass::submit(RenderQueue& queue, GLuint program, float depth)
+{
+	queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, program, 0, depth), [this, program] {
+		GLState::useProgram(program);
+		GLState::enable(GL_BLEND);
+		GLState::blendFunc(GL_ZERO, GL_ZERO);
+		for (int i = 0; i < cave.wallCount(); i++) {
+			cave.drawWall(program, i);
+		}
+		GLState::disable(GL_BLEND);
+	});
+}
+
+void QuadWallPass::submitViews(RenderQueue& queue, GLuint program, const ViewSet& views, float depth)
+{
+	queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, program, 0, depth), [this, program, &views] {
+		GLState::useProgram(program);
+		GLState::enable(GL_BLEND);
+		GLState::blendFunc(GL_ZERO, GL_ZERO);
+		cave.drawViews(program, views);
+		GLState::disable(GL_BLEND);
+	});
+}
+
+void QuadWallPass::composite(const glm::mat4& viewProjection)
+{
+	if (cave.quads == Cave::QUADS_EYE_BUFFER && layers) {
+		static_cast<EyeBufferQuadLayers&>(*layers).composite(viewProjection);
+	}
+}
+
+QuadLayers::Placement QuadWallPass::placement(const Cave::Wall& wall, const glm::ivec2& extent)
+{
+	QuadLayers::Placement placement;
+	glm::vec3 center = (wall.pb + wall.pc) * 0.5f;
+	placement.pose = glm::mat4(glm::vec4(wall.vr, 0.0f), glm::vec4(wall.vu, 0.0f), glm::vec4(wall.vn, 0.0f), glm::vec4(center, 1.0f));
+	placement.size = glm::vec2(glm::length(wall.pb - wall.pa), glm::length(wall.pc - wall.pa));
+	placement.extent = extent;
+	return placement;
+}
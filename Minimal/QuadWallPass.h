@@ -0,0 +1,70 @@
+#ifndef _QUADWALLPASS_H
+#define _QUADWALLPASS_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "Cave.h"
+#include "WallPass.h"
+#include "QuadLayers.h"
+#include <memory>
+#include <vector>
+
+// Quad mode: the walls are compositor layers and the eye buffer shows them
+// through alpha 0. A quad shows one image to both eyes, so the walls are
+// rendered once per frame from between the eyes. The left eye's state waits
+// for the right eye's pass.
+class QuadWallPass
+{
+public:
+	// The wall images use the PerView slots of a WallPass at firstSlot. Eye buffer
+	// mode makes its stand-in layers here, sdk mode gets them through setLayers.
+	QuadWallPass(Cave& cave, ViewBlock& viewBlock, int firstSlot, WallStats& stats, float nearPlane, float farPlane);
+
+	void setLayers(std::unique_ptr<QuadLayers> quads) { layers = std::move(quads); }
+	// Size of the wall images
+	GLsizei imageSize() { return images.current(0).size; }
+	// Resolution each wall was last rendered at
+	const std::vector<glm::ivec2>& extent() { return images.current(0).extent; }
+
+	// Keep the left eye's state, then on the right eye render the walls both eyes see from the
+	// midpoint between them and hand the refreshed ones to the quad layers. The arguments are
+	// those WallPass::render takes.
+	void render(int eye, const glm::mat4& modelview, const glm::mat4& hmdView, const glm::vec3& eyePos,
+		int wallMask, int visibleMask, std::vector<glm::ivec2>& extent, WallContent& content);
+
+	// Queue clearing the eye buffer to alpha 0 where the walls show, drawn with program
+	void submit(RenderQueue& queue, GLuint program, float depth);
+	// The same for every view of a view set pass, views must live until the queue runs
+	void submitViews(RenderQueue& queue, GLuint program, const ViewSet& views, float depth);
+	// Eye buffer mode composites the quads itself once the eye buffer is complete
+	void composite(const glm::mat4& viewProjection);
+
+private:
+	// Quad covering a wall, the wall faces the viewer along vn
+	static QuadLayers::Placement placement(const Cave::Wall& wall, const glm::ivec2& extent);
+
+	Cave& cave;
+	float nearPlane, farPlane;
+	// One set of wall images for both eyes
+	WallPass images;
+	std::unique_ptr<QuadLayers> layers;
+
+	// The left eye's pass
+	glm::mat4 leftView;
+	glm::vec3 leftEyePos;
+	int leftWallMask, leftVisibleMask;
+	std::vector<glm::ivec2> leftExtent;
+};
+
+#endif
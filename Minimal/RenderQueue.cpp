@@ -0,0 +1,29 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+uint64_t RenderQueue::key(Pass pass, GLuint program, GLuint texture, float depth)
+{
+	// The bits of a non-negative float sort like the float itself
+	uint32_t depthBits = 0;
+	if (depth > 0.0f) {
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	}
+	return ((uint64_t)(pass & 0xF) << 60) | ((uint64_t)(program & 0xFFF) << 48) |
+		((uint64_t)(texture & 0xFFFF) << 32) | depthBits;
+}
+
+void RenderQueue::submit(uint64_t key, const std::function<void()>& draw)
+{
+	packets.push_back({ key, draw });
+}
+
+void RenderQueue::execute()
+{
+	std::stable_sort(packets.begin(), packets.end(), [](const Packet& a, const Packet& b) { return a.key < b.key; });
+	for (const Packet& packet : packets) {
+		packet.draw();
+	}
+	// Keeps its capacity, the next pass submits about as many packets
+	packets.clear();
+}
@@ -0,0 +1,49 @@
+#ifndef _RENDERQUEUE_H
+#define _RENDERQUEUE_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Draws of one pass collected as packets and run in the order of their sort
+// keys. The key holds, most significant first, the pass, the program, the
+// texture and the depth, so opaque draws run before the skybox, draws sharing
+// a program and texture run back to back and within those the nearest first.
+// Packets with equal keys run in the order they were submitted.
+class RenderQueue
+{
+public:
+	enum Pass {
+		// Depth tested and written, front to back
+		PASS_OPAQUE,
+		// Drawn on the far plane behind a depth test, only where nothing opaque is
+		PASS_SKY
+	};
+
+	// Key bits: pass 63-60, program 59-48, texture 47-32, depth 31-0. depth is a
+	// distance from the eye, negative distances sort as 0.
+	static uint64_t key(Pass pass, GLuint program, GLuint texture, float depth);
+
+	void submit(uint64_t key, const std::function<void()>& draw);
+	// Sort the packets, run them and empty the queue
+	void execute();
+
+	size_t size() const { return packets.size(); }
+
+private:
+	struct Packet {
+		uint64_t key;
+		std::function<void()> draw;
+	};
+	std::vector<Packet> packets;
+};
+
+#endif
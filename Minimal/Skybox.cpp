@@ -1,4 +1,5 @@
 ﻿#include "Skybox.h"
+#include "GLState.h"
 
 #include <GL/glew.h>
 #include <iostream>
@@ -15,10 +16,20 @@ Skybox::~Skybox()
 
 void Skybox::draw(unsigned skyboxShader, const glm::mat4& p, const glm::mat4& v)
 {
-  glEnable(GL_CULL_FACE);
-  glCullFace(GL_BACK);
-  glDepthMask(GL_FALSE);
+  GLState::enable(GL_CULL_FACE);
+  GLState::cullFace(GL_BACK);
+  GLState::depthMask(GL_FALSE);
   TexturedCube::draw(skyboxShader, p, glm::mat4(glm::mat3(v)));
-  glDepthMask(GL_TRUE);
-  glCullFace(GL_FRONT);
+  GLState::depthMask(GL_TRUE);
+  GLState::cullFace(GL_FRONT);
+}
+
+void Skybox::draw(unsigned skyboxShader, const glm::mat4& v)
+{
+  GLState::enable(GL_CULL_FACE);
+  GLState::cullFace(GL_BACK);
+  GLState::depthMask(GL_FALSE);
+  TexturedCube::draw(skyboxShader, glm::mat4(glm::mat3(v)));
+  GLState::depthMask(GL_TRUE);
+  GLState::cullFace(GL_FRONT);
 }
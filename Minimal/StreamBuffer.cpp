@@ -0,0 +1,94 @@
+#include "StreamBuffer.h"
+#include <cstring>
+#include <iostream>
+
+StreamBuffer::StreamBuffer(GLsizeiptr bytesPerFrame) :
+	stalls(0), mapped(nullptr), regionSize(bytesPerFrame), region(0), head(0), overflowReported(false)
+{
+	for (int i = 0; i < FRAMES; i++) {
+		fences[i] = 0;
+	}
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	if (GLEW_ARB_buffer_storage) {
+		// Coherent, so a memcpy is visible to the next draw without a flush
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, regionSize * FRAMES, NULL, flags);
+		mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * FRAMES, flags);
+		if (!mapped) {
+			std::cerr << "stream buffer can't be mapped, falling back to glBufferSubData" << std::endl;
+		}
+	}
+	if (!mapped) {
+		// Immutable storage can't be respecified, start over with a mutable buffer
+		glDeleteBuffers(1, &VBO);
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, regionSize * FRAMES, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for (GLsync sync : fences) {
+		if (sync) {
+			glDeleteSync(sync);
+		}
+	}
+	if (mapped) {
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &VBO);
+}
+
+void StreamBuffer::beginFrame()
+{
+	region = (region + 1) % FRAMES;
+	head = 0;
+	if (fences[region]) {
+		GLenum result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			stalls++;
+			// One second, the frame is lost long before that
+			glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+}
+
+void StreamBuffer::endFrame()
+{
+	if (fences[region]) {
+		glDeleteSync(fences[region]);
+	}
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLintptr StreamBuffer::write(const void* data, GLsizeiptr size, GLsizeiptr alignment)
+{
+	GLintptr begin = region * regionSize;
+	GLintptr offset = (begin + head + alignment - 1) / alignment * alignment;
+	if (offset + size > begin + regionSize) {
+		if (!overflowReported) {
+			std::cerr << "stream buffer region of " << regionSize << " bytes is full" << std::endl;
+			overflowReported = true;
+		}
+		return -1;
+	}
+	head = offset + size - begin;
+
+	if (mapped) {
+		memcpy(mapped + offset, data, size);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	return offset;
+}
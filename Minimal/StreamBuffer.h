@@ -0,0 +1,54 @@
+#ifndef _STREAMBUFFER_H
+#define _STREAMBUFFER_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+
+// One buffer for the data written fresh every frame: line vertices, per view
+// uniform blocks. It is split into FRAMES regions used round robin, so the CPU
+// fills one region while the GPU still reads the two before it. A fence after
+// each frame tells when its region can be written again. With
+// GL_ARB_buffer_storage the buffer stays mapped and a write is a memcpy,
+// without it the writes fall back to glBufferSubData.
+class StreamBuffer
+{
+public:
+	// Frames in flight
+	enum { FRAMES = 3 };
+
+	StreamBuffer(GLsizeiptr bytesPerFrame);
+	~StreamBuffer();
+
+	// Start writing the next region, blocks until the GPU is done reading it
+	void beginFrame();
+	// Call after the last draw reading this frame's writes has been submitted
+	void endFrame();
+
+	// Copy size bytes into this frame's region at a multiple of alignment, which
+	// need not be a power of two. Returns the offset in buffer(), -1 if the region is full.
+	GLintptr write(const void* data, GLsizeiptr size, GLsizeiptr alignment = 16);
+
+	GLuint buffer() const { return VBO; }
+	// False when the writes go through glBufferSubData
+	bool persistent() const { return mapped != nullptr; }
+
+	// Times beginFrame had to wait for the GPU
+	unsigned int stalls;
+
+private:
+	GLuint VBO;
+	char* mapped;
+	GLsizeiptr regionSize;
+	GLsync fences[FRAMES];
+	// Region being written and the next free byte in it
+	int region;
+	GLsizeiptr head;
+	bool overflowReported;
+};
+
+#endif
@@ -1,4 +1,5 @@
 ﻿#include "TexturedCube.h"
+#include "GLState.h"
 #include <GL/glew.h>
 #include <iostream>
 #include <vector>
@@ -62,7 +63,7 @@ unsigned loadCubemap(const std::string directory, std::vector<std::string>& face
 {
   unsigned int textureID;
   glGenTextures(1, &textureID);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+  GLState::bindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
   int width, height;
   for (unsigned int i = 0; i < faces.size(); i++)
@@ -106,26 +107,30 @@ TexturedCube::TexturedCube(const std::string dir) : Cube()
 
 TexturedCube::~TexturedCube()
 {
-  glDeleteTextures(1, &cubeMap);
+  GLState::deleteTextures(1, &cubeMap);
 }
 
 void TexturedCube::draw(unsigned shader, const glm::mat4& p, const glm::mat4& v)
 {
-  glUseProgram(shader);
-  // ... set view and projection matrix
-  uProjection = glGetUniformLocation(shader, "projection");
-  uView = glGetUniformLocation(shader, "view");
+  GLState::useProgram(shader);
+  // ... set projection matrix, draw() below takes care of the view
+  uProjection.set(shader, p);
 
+  draw(shader, v);
+}
+
+void TexturedCube::draw(unsigned shader, const glm::mat4& v)
+{
+  GLState::useProgram(shader);
+  // ... set view matrix
   glm::mat4 modelview = v * toWorld;
 
   // Now send these values to the shader program
-  glUniformMatrix4fv(uProjection, 1, GL_FALSE, &p[0][0]);
-  glUniformMatrix4fv(uView, 1, GL_FALSE, &modelview[0][0]);
+  uView.set(shader, modelview);
 
-  glBindVertexArray(VAO);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
-  glUniform1i(glGetUniformLocation(shader, "skybox"), 0);
+  GLState::bindVertexArray(VAO);
+  GLState::activeTexture(GL_TEXTURE0);
+  GLState::bindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
+  uSkybox.set(shader, 0);
   glDrawArrays(GL_TRIANGLES, 0, 36);
-  glBindVertexArray(0);
 }
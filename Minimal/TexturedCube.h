@@ -12,9 +12,12 @@ public:
   ~TexturedCube();
 
   void draw(unsigned int shader, const glm::mat4& p, const glm::mat4& v);
+  // Draw without touching the projection, for programs that supply their own (layered wall pass)
+  void draw(unsigned int shader, const glm::mat4& v);
 
   // These variables are needed for the shader program
   unsigned int cubeMap;
-  unsigned int uProjection, uView;
+  Uniform<glm::mat4> uView{ "view" };
+  Uniform<GLint> uSkybox{ "skybox" };
 };
 #endif
@@ -0,0 +1,34 @@
+#include "ViewBlock.h"
+#include <iostream>
+
+static_assert(sizeof(ViewBlock::Data) == 8 * 64 + 16, "ViewBlock::Data must match the std140 layout of PerView");
+
+ViewBlock::ViewBlock(StreamBuffer& stream, int slots) : stream(stream), offsets(slots, -1), alignment(256)
+{
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+}
+
+void ViewBlock::attach(GLuint program)
+{
+	GLuint index = glGetUniformBlockIndex(program, "PerView");
+	if (index != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, index, BINDING);
+	}
+}
+
+void ViewBlock::write(int slot, const Data& data)
+{
+	if (slot < 0 || slot >= (int)offsets.size()) {
+		std::cerr << "view block slot " << slot << " out of range" << std::endl;
+		return;
+	}
+	offsets[slot] = stream.write(&data, sizeof(Data), alignment);
+	bind(slot);
+}
+
+void ViewBlock::bind(int slot) const
+{
+	if (offsets[slot] >= 0) {
+		glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, stream.buffer(), offsets[slot], sizeof(Data));
+	}
+}
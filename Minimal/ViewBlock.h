@@ -0,0 +1,61 @@
+#ifndef _VIEWBLOCK_H
+#define _VIEWBLOCK_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "StreamBuffer.h"
+#include <vector>
+
+// Camera data shared by every program through the PerView uniform block. Each
+// view of a frame (an eye pass, a wall pass) owns a slot. A slot is written to
+// the stream buffer once when its view starts and bound to BINDING, the draws
+// of the view then only upload their own object matrices.
+class ViewBlock
+{
+public:
+	// Binding point attach assigns to every PerView block
+	enum { BINDING = 0 };
+	// Matches MAX_WALLS in the shaders declaring the block and Cave::MAX_WALLS
+	enum { MAX_WALLS = 6 };
+
+	// std140 layout of PerView, mat4 and vec4 members need no padding
+	struct Data {
+		glm::mat4 eyeProjection;
+		// World to eye
+		glm::mat4 eyeView;
+		// Off-axis projection of each wall, set by the wall passes
+		glm::mat4 wallProjection[MAX_WALLS];
+		// World space eye position, w unused
+		glm::vec4 eyePosition;
+	};
+
+	ViewBlock(StreamBuffer& stream, int slots);
+
+	// Point the PerView block of a program at BINDING, GLSL 4.1 can't give one
+	// in the layout. Does nothing for a program without the block.
+	static void attach(GLuint program);
+
+	// Write a slot and bind it
+	void write(int slot, const Data& data);
+	// Bind a slot written earlier in the frame
+	void bind(int slot) const;
+
+private:
+	StreamBuffer& stream;
+	// Where each slot was last written, -1 if it wasn't
+	std::vector<GLintptr> offsets;
+	GLint alignment;
+};
+
+#endif
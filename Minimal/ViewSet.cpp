@@ -0,0 +1,36 @@
+#include "ViewSet.h"
+#include "Program.h"
+#include <iostream>
+
+namespace
+{
+	// Shared by every program using the geometry shaders
+	const Uniform<GLint> uViewCount("viewCount"), uViewEye("viewEye");
+	const Uniform<glm::mat4> uViewProjection("viewProjection");
+	const Uniform<glm::vec4> uViewRect("viewRect");
+}
+
+void ViewSet::add(const glm::mat4& projection, const glm::mat4& view, int eye, const glm::vec4& rect)
+{
+	if (count == MAX_VIEWS) {
+		std::cerr << "view set holds at most " << MAX_VIEWS << " views" << std::endl;
+		return;
+	}
+	this->projection[count] = projection;
+	this->view[count] = view;
+	this->eye[count] = eye;
+	this->rect[count] = rect;
+	count++;
+}
+
+void ViewSet::upload(GLuint shaderProgram, bool rotationOnly) const
+{
+	glm::mat4 viewProjection[MAX_VIEWS];
+	for (int i = 0; i < count; i++) {
+		viewProjection[i] = projection[i] * (rotationOnly ? glm::mat4(glm::mat3(view[i])) : view[i]);
+	}
+	uViewCount.set(shaderProgram, count);
+	uViewProjection.set(shaderProgram, viewProjection, count);
+	uViewEye.set(shaderProgram, eye, count);
+	uViewRect.set(shaderProgram, rect, count);
+}
@@ -0,0 +1,40 @@
+#ifndef _VIEWSET_H
+#define _VIEWSET_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+// Views a single draw is sent to by the *_stereo.geom geometry shaders. View i
+// goes to viewport i with its own projection and view. It belongs to one eye
+// and its viewport covers a rectangle of that eye's NDC, the shaders drop
+// triangles outside that rectangle.
+struct ViewSet
+{
+	// At least VIEW_COUNT of the geometry shaders: both eyes, or 3x3 regions of one eye
+	enum { MAX_VIEWS = 9 };
+
+	int count = 0;
+	glm::mat4 projection[MAX_VIEWS];
+	glm::mat4 view[MAX_VIEWS];
+	int eye[MAX_VIEWS];
+	// (x0, y0, x1, y1) in the eye's NDC
+	glm::vec4 rect[MAX_VIEWS];
+
+	void add(const glm::mat4& projection, const glm::mat4& view, int eye, const glm::vec4& rect = glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f));
+
+	// Set the view uniforms of a program using the geometry shaders. rotationOnly
+	// drops the translation of each view, as Skybox::draw does.
+	void upload(GLuint shaderProgram, bool rotationOnly = false) const;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "ViewSetPass.h"
+#include "shader.h"
+#include "GLState.h"
+
+ViewSetPass::ViewSetPass(const std::string& viewDefines)
+{
+	caveShaderID = LoadShaders("cave_stereo.vert", "cave_stereo.geom", "shader.frag", viewDefines.c_str());
+	skyboxShaderID = LoadShaders("wall.vert", "skybox_stereo.geom", "skybox.frag", viewDefines.c_str());
+	lineShaderID = LoadShaders("line_stereo.vert", "line_stereo.geom", "line.frag", viewDefines.c_str());
+}
+
+void ViewSetPass::submitLines(RenderQueue& queue, const ViewSet& views, const std::vector<Line*>& left, const std::vector<Line*>& right)
+{
+	queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, lineShaderID, 0, 0.0f), [this, &views, &left, &right] {
+		GLState::useProgram(lineShaderID);
+		views.upload(lineShaderID);
+		for (size_t i = 0; i < left.size() && i < right.size(); i++) {
+			left[i]->draw(lineShaderID);
+			right[i]->draw(lineShaderID);
+		}
+	});
+}
+
+void ViewSetPass::submitSkybox(RenderQueue& queue, const ViewSet& views, Skybox& skybox)
+{
+	queue.submit(RenderQueue::key(RenderQueue::PASS_SKY, skyboxShaderID, skybox.cubeMap, 0.0f), [this, &views, &skybox] {
+		GLState::useProgram(skyboxShaderID);
+		views.upload(skyboxShaderID, true);
+		skybox.draw(skyboxShaderID, glm::mat4(1.0f));
+	});
+}
@@ -0,0 +1,44 @@
+#ifndef _VIEWSETPASS_H
+#define _VIEWSETPASS_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "ViewSet.h"
+#include "RenderQueue.h"
+#include "Skybox.h"
+#include "Line.h"
+#include <string>
+#include <vector>
+
+// Stereo and multi-resolution mode: a geometry shader sends each draw to the
+// viewport of every view in the set, so the scene is submitted once for all of them.
+class ViewSetPass
+{
+public:
+	// viewDefines sets the view count of the geometry shaders, as EyeBufferConfig::viewDefines gives it
+	explicit ViewSetPass(const std::string& viewDefines);
+
+	// Program the wall passes draw the cave of a view set with
+	GLuint caveProgram() const { return caveShaderID; }
+
+	// Queue the lines of both eyes, they start at the eye. views must live until the queue runs.
+	void submitLines(RenderQueue& queue, const ViewSet& views, const std::vector<Line*>& left, const std::vector<Line*>& right);
+	// Queue the skybox behind everything else, it only turns with the eye as in Skybox::draw
+	void submitSkybox(RenderQueue& queue, const ViewSet& views, Skybox& skybox);
+
+private:
+	GLuint caveShaderID, skyboxShaderID, lineShaderID;
+};
+
+#endif
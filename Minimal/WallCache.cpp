@@ -0,0 +1,79 @@
+#include "WallCache.h"
+
+WallCache::WallCache() : hits(0), misses(0), validLayers(0)
+{
+}
+
+bool WallCache::isCurrent(const WallInputs& inputs) const
+{
+	if (validLayers == 0) {
+		return false;
+	}
+
+	// Every wall visible now must have been rendered for this scene
+	if ((validLayers & inputs.visibleMask) != inputs.visibleMask || last.extent.size() != inputs.extent.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < inputs.extent.size(); i++) {
+		if ((inputs.visibleMask & (1 << i)) == 0) {
+			continue;
+		}
+		if (last.extent[i].x < inputs.extent[i].x || last.extent[i].y < inputs.extent[i].y) {
+			return false;
+		}
+	}
+
+	// Every visible part requested now must have been covered, an empty rectangle needs nothing
+	if (last.visible.size() != inputs.visible.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < inputs.visible.size(); i++) {
+		const glm::vec4& now = inputs.visible[i];
+		const glm::vec4& then = last.visible[i];
+		if (now.z <= now.x || now.w <= now.y) {
+			continue;
+		}
+		if ((validLayers & (1 << i)) == 0 || now.x < then.x || now.y < then.y || now.z > then.z || now.w > then.w) {
+			return false;
+		}
+	}
+
+	return sameScene(inputs);
+}
+
+bool WallCache::sameScene(const WallInputs& inputs) const
+{
+	// Cheap scalars first, the instance list last
+	return last.wallMask == inputs.wallMask
+		&& last.skybox == inputs.skybox
+		&& last.cubeSize == inputs.cubeSize
+		&& last.eyePos == inputs.eyePos
+		&& last.view == inputs.view
+		&& last.caveToWorld == inputs.caveToWorld
+		&& last.insets == inputs.insets
+		&& last.instances == inputs.instances;
+}
+
+void WallCache::update(const WallInputs& inputs, int layerMask)
+{
+	// Layers rendered for another scene or layout are stale
+	if (validLayers == 0 || !sameScene(inputs) || last.extent.size() != inputs.extent.size()
+		|| last.visible.size() != inputs.visible.size()) {
+		last = inputs;
+		validLayers = layerMask;
+		return;
+	}
+	for (size_t i = 0; i < inputs.extent.size(); i++) {
+		if (layerMask & (1 << i)) {
+			last.extent[i] = inputs.extent[i];
+			last.visible[i] = inputs.visible[i];
+		}
+	}
+	last.visibleMask = inputs.visibleMask;
+	validLayers |= layerMask;
+}
+
+void WallCache::invalidate()
+{
+	validLayers = 0;
+}
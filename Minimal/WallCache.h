@@ -0,0 +1,71 @@
+#ifndef _WALLCACHE_H
+#define _WALLCACHE_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/mat4x4.hpp>
+#include <vector>
+
+// Everything a set of wall images depends on
+struct WallInputs
+{
+	glm::vec3 eyePos;
+	glm::mat4 view;
+	glm::mat4 caveToWorld;
+	GLuint skybox;
+	std::vector<glm::mat4> instances;
+	float cubeSize;
+	// Projector mask, bit i set means wall i is lit
+	int wallMask;
+	// Walls inside the HMD frustum, only these have to be up to date
+	int visibleMask;
+	// Resolution each wall is rendered at
+	std::vector<glm::ivec2> extent;
+	// Foveal inset of each wall as uv rectangle (u0, v0, u1, v1), empty when not foveated
+	std::vector<glm::vec4> insets;
+	// Part of each layer the HMD sees as uv rectangle, only that part is rendered
+	std::vector<glm::vec4> visible;
+};
+
+// Remembers the inputs each wall layer was last rendered with so a pass can
+// be skipped when nothing changed, e.g. while Freeze mode holds the eye position.
+// Layers are tracked one by one, so passes refreshing a few walls in place add
+// up to a valid set once every visible wall has been rendered for the same scene.
+class WallCache
+{
+public:
+	WallCache();
+
+	// True if the images rendered for the stored inputs are still valid.
+	// Images rendered at a higher resolution or over a larger visible part than
+	// requested stay valid, and only walls in inputs.visibleMask have to be up to date.
+	bool isCurrent(const WallInputs& inputs) const;
+	// Record the inputs of a wall pass that rendered the layers in layerMask. Layers
+	// rendered earlier for the same scene stay valid, call invalidate first if the
+	// pass went to a new target.
+	void update(const WallInputs& inputs, int layerMask);
+	// Force the next pass to render
+	void invalidate();
+
+	// Passes skipped and rendered since startup
+	unsigned int hits, misses;
+
+private:
+	// True if everything but the per layer extent and visible part matches
+	bool sameScene(const WallInputs& inputs) const;
+
+	// Layers holding images of the scene in last
+	int validLayers;
+	WallInputs last;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#include "WallContent.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+
+glm::mat4 WallContent::toWorld(size_t i) const
+{
+	return (*instances)[i] * glm::scale(glm::mat4(1.0f), glm::vec3(cubeSize));
+}
+
+void WallContent::cull(const Frustum* wallFrusta, int wallCount)
+{
+	bounds.resize(count());
+	for (size_t i = 0; i < count(); i++) {
+		const glm::mat4& m = (*instances)[i];
+		float scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+		bounds[i] = glm::vec4(glm::vec3(m[3]), cubeSize * scale * 1.7320508f);
+	}
+	cullSpheres(wallFrusta, wallCount, bounds, wallMasks);
+}
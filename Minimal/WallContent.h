@@ -0,0 +1,47 @@
+#ifndef _WALLCONTENT_H
+#define _WALLCONTENT_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+#include "Skybox.h"
+#include "TexturedCube.h"
+#include <vector>
+
+// What the walls show: the cube instances and each eye's skybox, owned by the
+// scene. A wall pass tests every instance against all its wall frusta in one
+// batch and then only submits an instance to the walls it falls into.
+struct WallContent
+{
+	enum { EYES = 2 };
+
+	TexturedCube* cube = nullptr;
+	const std::vector<glm::mat4>* instances = nullptr;
+	float cubeSize = 0.0f;
+	Skybox* skyboxes[EYES] = {};
+
+	size_t count() const { return instances->size(); }
+	// Instance i scaled to cubeSize
+	glm::mat4 toWorld(size_t i) const;
+
+	// Bit w of wallMasks[i] is set when instance i touches wallFrusta[w]
+	void cull(const Frustum* wallFrusta, int wallCount);
+	std::vector<int> wallMasks;
+
+private:
+	// Bounding sphere of each instance, the unit cube scaled by cubeSize
+	std::vector<glm::vec4> bounds;
+};
+
+#endif
@@ -0,0 +1,344 @@
+#include "WallPass.h"
+#include "WallView.h"
+#include "shader.h"
+#include "GLState.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+WallPass::WallPass(Cave& cave, ViewBlock& viewBlock, int firstSlot, WallStats& stats, bool mono, float nearPlane, float farPlane) :
+	cave(cave), viewBlock(viewBlock), firstSlot(firstSlot), stats(stats), nearPlane(nearPlane), farPlane(farPlane)
+{
+	// A ring of targets per eye so a frozen image survives the other eye's pass and a new pass
+	// doesn't wait for the last frame to stop sampling or writing. Each target has its own depth,
+	// a shared one would order every pass after the previous one's depth writes.
+	// Layers are sized for the largest wall, smaller walls use a sub-rectangle
+	glm::ivec2 wallSize = cave.maxResolution();
+	// Amortized mode updates walls in place and reprojects through their depth, so each eye
+	// keeps one target.
+	GLsizei size = std::max(wallSize.x, wallSize.y);
+	int ringSize = cave.wallsPerPass > 0 ? 1 : RING_SIZE;
+	// Foveated mode adds one inset layer per wall
+	int layers = cave.foveated ? 2 * cave.wallCount() : cave.wallCount();
+	rings[0] = std::make_unique<WallRing>(ringSize, size, layers, cave.colorFormat);
+	if (!mono) {
+		rings[1] = std::make_unique<WallRing>(ringSize, size, layers, cave.colorFormat);
+	}
+	std::cout << "wall targets: " << cave.wallCount() << " walls at " << size << "x" << size << " "
+		<< WallTarget::formatName(cave.colorFormat) << ", " << (mono ? 1 : 2) * ringSize << " sets, "
+		<< (rings[0]->memoryBytes() + (mono ? 0 : rings[1]->memoryBytes())) / (1024 * 1024) << " MB" << std::endl;
+
+	program = LoadShaders("wall.vert", "wall.geom", "skybox.frag");
+	ViewBlock::attach(program);
+}
+
+int WallPass::render(int eye, const glm::mat4& modelview, const glm::mat4& hmdView, const glm::vec3& eyePos, const glm::mat4* wallProjections,
+	int wallMask, int visibleMask, std::vector<glm::ivec2>& extent, std::vector<glm::vec4>& visible, WallContent& content)
+{
+	const std::vector<Cave::Wall>& caveWalls = cave.getWalls();
+	int wallCount = cave.wallCount();
+	Skybox* skybox = content.skyboxes[eye];
+
+	// Foveated mode: the periphery drops to a fraction of the density, an inset around
+	// where the HMD looks keeps it. Inset i lives in layer wallCount + i.
+	Cave::Insets& fovea = insets[eye];
+	fovea.mask = 0;
+	if (cave.foveated) {
+		glm::mat4 hmdPose = glm::inverse(hmdView);
+		glm::vec3 gazeOrigin = glm::vec3(hmdPose[3]);
+		glm::vec3 gazeForward = -glm::normalize(glm::vec3(hmdPose[2]));
+		for (int i = 0; i < wallCount; i++) {
+			if ((visibleMask & (1 << i)) == 0) {
+				continue;
+			}
+			const Cave::Wall& wall = caveWalls[i];
+			glm::vec4& rect = fovea.rect[i];
+			if (insetRect(wall, gazeOrigin, gazeForward, rect)) {
+				fovea.mask |= 1 << i;
+				extent[wallCount + i] = glm::ivec2(WallView::quantize(extent[i].x * (rect.z - rect.x), wall.resolution.x),
+					WallView::quantize(extent[i].y * (rect.w - rect.y), wall.resolution.y));
+				insetProjections[eye][i] = WallView::projection(eyePos, insetWall(wall, rect), nearPlane, farPlane);
+				// The visible part of the wall in inset uv
+				glm::vec2 lower = glm::vec2(rect.x, rect.y), size = glm::vec2(rect.z, rect.w) - lower;
+				const glm::vec4& seen = visible[i];
+				visible[wallCount + i] = glm::vec4(glm::clamp((glm::vec2(seen.x, seen.y) - lower) / size, glm::vec2(0.0f), glm::vec2(1.0f)),
+					glm::clamp((glm::vec2(seen.z, seen.w) - lower) / size, glm::vec2(0.0f), glm::vec2(1.0f)));
+			}
+			extent[i] = glm::ivec2(WallView::quantize((float)extent[i].x / PERIPHERY_SCALE, wall.resolution.x),
+				WallView::quantize((float)extent[i].y / PERIPHERY_SCALE, wall.resolution.y));
+		}
+	}
+
+	// Skip the pass when the images from the last one are still valid
+	WallInputs inputs;
+	inputs.eyePos = eyePos;
+	inputs.view = modelview;
+	inputs.caveToWorld = cave.toWorld;
+	// The analytic skybox isn't part of the images
+	inputs.skybox = cave.analyticSky ? 0 : skybox->cubeMap;
+	inputs.instances = *content.instances;
+	inputs.cubeSize = content.cubeSize;
+	inputs.wallMask = wallMask;
+	inputs.visibleMask = visibleMask;
+	inputs.extent = extent;
+	inputs.visible = visible;
+	if (fovea.mask != 0) {
+		inputs.insets.assign(fovea.rect, fovea.rect + wallCount);
+		for (int i = 0; i < wallCount; i++) {
+			if ((fovea.mask & (1 << i)) == 0) {
+				inputs.insets[i] = glm::vec4(0.0f);
+			}
+		}
+	}
+
+	// Analytic mode looks the skybox up behind the cubes when the walls are drawn,
+	// with the view the wall pass would have drawn it with. The Cube mesh spans [-1, 1].
+	if (cave.analyticSky) {
+		Cave::Sky& wallSky = sky[eye];
+		wallSky.mask = wallMask;
+		wallSky.cubeMap = skybox->cubeMap;
+		wallSky.halfSize = glm::length(glm::vec3(skybox->toWorld[0]));
+		wallSky.rotation = glm::mat3(modelview) * glm::mat3(skybox->toWorld) / wallSky.halfSize;
+		wallSky.eyePos = eyePos;
+	}
+
+	int refreshMask = 0;
+	bool amortized = cave.wallsPerPass > 0;
+	WallCache& cache = caches[eye];
+	if (cache.isCurrent(inputs)) {
+		cache.hits++;
+		stats.wallsCached += bitCount(visibleMask);
+	}
+	else {
+		cache.misses++;
+
+		// Amortized mode refreshes a few walls in place, the rest are reprojected from their last image.
+		// Otherwise every visible wall goes to the next target in the ring.
+		refreshMask = amortized ? selectWalls(eye, visibleMask, extent, modelview, eyePos) : visibleMask;
+		// Walls refreshed in place add to the ones rendered before, a new ring target starts empty
+		if (!amortized) {
+			cache.invalidate();
+		}
+		cache.update(inputs, refreshMask | (fovea.mask << wallCount));
+
+		// Clear the refreshed walls, then render the scene to all of them at once.
+		// Walls outside the HMD frustum get no draws, the cache doesn't count on them.
+		WallTarget& target = amortized ? rings[eye]->current() : rings[eye]->advance();
+		for (int i = 0; i < wallCount; i++) {
+			if (fovea.mask & (1 << i)) {
+				target.extent[wallCount + i] = extent[wallCount + i];
+				target.visible[wallCount + i] = visible[wallCount + i];
+			}
+			if (refreshMask & (1 << i)) {
+				target.extent[i] = extent[i];
+				target.visible[i] = visible[i];
+				WallFrame& frame = frames[eye][i];
+				frame.valid = true;
+				frame.viewProjection = wallProjections[i] * modelview;
+				frame.view = modelview;
+				frame.eyePos = eyePos;
+				frame.age = 0;
+			}
+			else {
+				frames[eye][i].age++;
+			}
+		}
+		target.bind();
+		// Analytic mode leaves the background transparent for the skybox
+		GLState::clearColor(0.f, 0.f, 0.f, cave.analyticSky ? 0.0f : 1.0f);
+		target.clear(refreshMask | (fovea.mask << wallCount));
+
+		int drawMask = wallMask & refreshMask;
+		if (drawMask != 0) {
+			// Find the walls each cube instance falls into, the cubes go through the same view as the skybox
+			Frustum wallFrusta[Cave::MAX_WALLS];
+			for (int i = 0; i < wallCount; i++) {
+				wallFrusta[i] = Frustum(wallProjections[i] * modelview);
+			}
+			content.cull(wallFrusta, wallCount);
+
+			draw(eye, modelview, wallProjections, 0, drawMask, content);
+			if ((drawMask & fovea.mask) != 0) {
+				draw(eye, modelview, insetProjections[eye], wallCount, drawMask & fovea.mask, content);
+				stats.insetsRendered += bitCount(drawMask & fovea.mask);
+			}
+		}
+		// Reprojection reads the depth back later
+		if (!amortized) {
+			target.invalidateDepth();
+		}
+		target.unbind();
+		stats.wallsRendered += bitCount(refreshMask);
+	}
+
+	// Warp walls last rendered from another view to this one
+	Cave::Reprojection& warp = reprojection[eye];
+	warp.staleMask = 0;
+	warp.eyePos = eyePos;
+	if (amortized) {
+		glm::mat4 inverseView = glm::inverse(modelview);
+		for (int i = 0; i < wallCount; i++) {
+			const WallFrame& frame = frames[eye][i];
+			if (!frame.valid || (frame.eyePos == eyePos && frame.view == modelview)) {
+				continue;
+			}
+			warp.staleMask |= 1 << i;
+			warp.toCurrent[i] = modelview * glm::inverse(frame.viewProjection);
+			warp.toOld[i] = frame.viewProjection * inverseView;
+		}
+		stats.wallsReprojected += bitCount(warp.staleMask & visibleMask);
+	}
+	return refreshMask;
+}
+
+Cave::EyeWalls WallPass::eyeWalls(int eye)
+{
+	return { &rings[eye]->current(), &reprojection[eye], &insets[eye], cave.analyticSky ? &sky[eye] : nullptr };
+}
+
+void WallPass::submit(RenderQueue& queue, GLuint caveProgram, int eye, float depth)
+{
+	queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, caveProgram, current(eye).colorTexture, depth), [this, caveProgram, eye] {
+		Cave::EyeWalls walls = eyeWalls(eye);
+		GLState::useProgram(caveProgram);
+		cave.draw(caveProgram, *walls.target, walls.reprojection, walls.insets, walls.sky);
+		fence(eye);
+	});
+}
+
+void WallPass::submitViews(RenderQueue& queue, GLuint caveProgram, const ViewSet& views, float depth)
+{
+	queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, caveProgram, current(0).colorTexture, depth), [this, caveProgram, &views] {
+		Cave::EyeWalls eyes[EYES];
+		int eyeMask = 0;
+		for (int eye = 0; eye < EYES; eye++) {
+			eyes[eye] = eyeWalls(eye);
+		}
+		for (int i = 0; i < views.count; i++) {
+			eyeMask |= 1 << views.eye[i];
+		}
+		GLState::useProgram(caveProgram);
+		cave.drawViews(caveProgram, views, eyes);
+		for (int eye = 0; eye < EYES; eye++) {
+			if (eyeMask & (1 << eye)) {
+				fence(eye);
+			}
+		}
+	});
+}
+
+void WallPass::draw(int eye, const glm::mat4& modelview, const glm::mat4* projections, int layerOffset, int drawMask, WallContent& content)
+{
+	// wall.geom reads the wall projections from this pass's PerView slot
+	ViewBlock::Data view = {};
+	view.eyeView = modelview;
+	for (int i = 0; i < cave.wallCount(); i++) {
+		view.wallProjection[i] = projections[i];
+	}
+	viewBlock.write(firstSlot + 2 * eye + (layerOffset == 0 ? 0 : 1), view);
+
+	GLState::useProgram(program);
+	uWallCount.set(program, cave.wallCount());
+	uLayerOffset.set(program, layerOffset);
+	uWallMask.set(program, drawMask);
+
+	TexturedCube* cube = content.cube;
+	for (size_t i = 0; i < content.count(); i++) {
+		// Only submit survivors, and only to the walls that see them
+		int mask = content.wallMasks[i] & drawMask;
+		if (mask == 0) {
+			stats.instancesCulled++;
+			continue;
+		}
+		glm::mat4 toWorld = content.toWorld(i);
+		float depth = -(modelview * toWorld[3]).z;
+		queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, program, cube->cubeMap, depth), [this, cube, mask, toWorld, modelview] {
+			uWallMask.set(program, mask);
+			cube->toWorld = toWorld;
+			cube->draw(program, modelview);
+		});
+		stats.instancesDrawn++;
+	}
+	if (!cave.analyticSky) {
+		// On the far plane after the cubes, early-Z drops what they cover
+		Skybox* skybox = content.skyboxes[eye];
+		queue.submit(RenderQueue::key(RenderQueue::PASS_SKY, program, skybox->cubeMap, 0.0f), [this, skybox, drawMask, modelview] {
+			uWallMask.set(program, drawMask);
+			uOnFarPlane.set(program, 1);
+			skybox->draw(program, modelview);
+			uOnFarPlane.set(program, 0);
+		});
+	}
+	queue.execute();
+}
+
+bool WallPass::insetRect(const Cave::Wall& wall, const glm::vec3& origin, const glm::vec3& forward, glm::vec4& rect) const
+{
+	// vn faces the viewer, a gaze towards the wall runs against it
+	float facing = glm::dot(forward, wall.vn);
+	if (facing >= 0.0f) {
+		return false;
+	}
+	float distance = glm::dot(wall.pa - origin, wall.vn) / facing;
+	if (distance <= 0.0f) {
+		return false;
+	}
+
+	glm::vec3 hit = origin + forward * distance;
+	float width = glm::length(wall.pb - wall.pa), height = glm::length(wall.pc - wall.pa);
+	glm::vec2 uv(glm::dot(hit - wall.pa, wall.vr) / width, glm::dot(hit - wall.pa, wall.vu) / height);
+	if (uv.x < 0.0f || uv.x > 1.0f || uv.y < 0.0f || uv.y > 1.0f) {
+		return false;
+	}
+
+	float radius = distance * std::tan(glm::radians((float)FOVEA_DEGREES));
+	glm::vec2 halfSize = glm::min(glm::ceil(glm::vec2(radius / width, radius / height) * (float)INSET_GRID) / (float)INSET_GRID, glm::vec2(0.5f));
+	glm::vec2 center = glm::floor(uv * (float)INSET_GRID + 0.5f) / (float)INSET_GRID;
+	center = glm::clamp(center, halfSize, glm::vec2(1.0f) - halfSize);
+	rect = glm::vec4(center - halfSize, center + halfSize);
+	return true;
+}
+
+Cave::Wall WallPass::insetWall(const Cave::Wall& wall, const glm::vec4& rect)
+{
+	Cave::Wall inset = wall;
+	glm::vec3 u = wall.pb - wall.pa, v = wall.pc - wall.pa;
+	inset.pa = wall.pa + u * rect.x + v * rect.y;
+	inset.pb = inset.pa + u * (rect.z - rect.x);
+	inset.pc = inset.pa + v * (rect.w - rect.y);
+	return inset;
+}
+
+int WallPass::selectWalls(int eye, int visibleMask, const std::vector<glm::ivec2>& extent, const glm::mat4& view, const glm::vec3& eyePos)
+{
+	const WallFrame* eyeFrames = frames[eye];
+	const WallTarget& target = rings[eye]->current();
+	int mask = 0, budget = cave.wallsPerPass;
+	for (int i = 0; i < cave.wallCount(); i++) {
+		bool visible = (visibleMask & (1 << i)) != 0;
+		if (visible && (!eyeFrames[i].valid || extent[i].x > target.extent[i].x || extent[i].y > target.extent[i].y)) {
+			mask |= 1 << i;
+			budget--;
+		}
+	}
+	for (; budget > 0; budget--) {
+		int best = -1;
+		float bestError = -1.0f;
+		for (int i = 0; i < cave.wallCount(); i++) {
+			if ((visibleMask & ~mask & (1 << i)) == 0) {
+				continue;
+			}
+			float error = glm::distance(eyePos, eyeFrames[i].eyePos) + glm::length(glm::vec3(view[2]) - glm::vec3(eyeFrames[i].view[2])) + eyeFrames[i].age * 0.001f;
+			if (error > bestError) {
+				best = i;
+				bestError = error;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+		mask |= 1 << best;
+	}
+	return mask;
+}
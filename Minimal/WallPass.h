@@ -0,0 +1,119 @@
+#ifndef _WALLPASS_H
+#define _WALLPASS_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "Cave.h"
+#include "WallRing.h"
+#include "WallCache.h"
+#include "WallContent.h"
+#include "WallStats.h"
+#include "ViewBlock.h"
+#include "ViewSet.h"
+#include "RenderQueue.h"
+#include "Program.h"
+#include <memory>
+#include <vector>
+
+// Renders the scene into wall images, every wall in one layered pass, and draws
+// the cave with them. Each eye has a ring of targets so a pass never writes the
+// images the last frame samples. A cache skips the pass while its inputs hold.
+// Amortized mode refreshes a few walls in place and reprojects the others,
+// foveated mode adds a full density inset per wall around the gaze and the
+// analytic skybox is looked up behind the images instead of drawn into them.
+class WallPass
+{
+public:
+	enum {
+		EYES = 2,
+		// Targets per eye, a wall pass never writes the target the last frame samples
+		RING_SIZE = 2,
+		// Foveated mode: half angle the inset covers around the gaze, the density
+		// divisor of the periphery and the grid insets snap to on their wall
+		FOVEA_DEGREES = 20,
+		PERIPHERY_SCALE = 2,
+		INSET_GRID = 32
+	};
+
+	// The pass of eye e writes PerView slot firstSlot + 2e, its insets the slot after.
+	// A mono pass keeps one set of wall images for both eyes, rendered as eye 0.
+	WallPass(Cave& cave, ViewBlock& viewBlock, int firstSlot, WallStats& stats, bool mono, float nearPlane, float farPlane);
+
+	// Fill the wall images of eye for the walls in visibleMask, skipped when the cache says the
+	// last images still hold. wallProjections are the eye's wall projections, extent is the
+	// resolution each layer needs and visible the uv rectangle of it that is shaded. Returns the
+	// walls it refreshed.
+	int render(int eye, const glm::mat4& modelview, const glm::mat4& hmdView, const glm::vec3& eyePos, const glm::mat4* wallProjections,
+		int wallMask, int visibleMask, std::vector<glm::ivec2>& extent, std::vector<glm::vec4>& visible, WallContent& content);
+
+	// Latest images of eye
+	WallTarget& current(int eye) { return rings[eye]->current(); }
+	// Call after the commands sampling eye's latest images have been submitted
+	void fence(int eye) { rings[eye]->fence(); }
+	// What eye's walls show, as Cave::draw takes it
+	Cave::EyeWalls eyeWalls(int eye);
+
+	// Queue the cave of an eye pass, drawn with caveProgram, depth is its distance from the eye
+	void submit(RenderQueue& queue, GLuint caveProgram, int eye, float depth);
+	// Queue the cave of a view set pass, each view shows its eye's images. views must live until the queue runs.
+	void submitViews(RenderQueue& queue, GLuint caveProgram, const ViewSet& views, float depth);
+
+private:
+	// Amortized mode: the view a wall image was last rendered from
+	struct WallFrame {
+		bool valid = false;
+		glm::mat4 viewProjection; // wall projection times view
+		glm::mat4 view;
+		glm::vec3 eyePos;
+		unsigned int age = 0; // wall passes since the last refresh
+	};
+
+	// Draw the skybox and the cubes into the walls of drawMask, layerOffset selects the layers
+	// the walls go to. The cubes are culled with content.wallMasks. Analytic mode leaves out the skybox.
+	void draw(int eye, const glm::mat4& modelview, const glm::mat4* projections, int layerOffset, int drawMask, WallContent& content);
+	// Foveated mode: uv rectangle on a wall covering FOVEA_DEGREES around the point the gaze hits,
+	// false if the gaze misses the wall. Snapped to INSET_GRID so small head motion keeps the wall cache valid.
+	bool insetRect(const Cave::Wall& wall, const glm::vec3& origin, const glm::vec3& forward, glm::vec4& rect) const;
+	// The part of a wall covered by a uv rectangle, as a wall of its own
+	static Cave::Wall insetWall(const Cave::Wall& wall, const glm::vec4& rect);
+	// Amortized mode: walls to refresh this pass. Walls without a usable image always go,
+	// then the ones whose view moved most since their last refresh, the oldest on ties
+	int selectWalls(int eye, int visibleMask, const std::vector<glm::ivec2>& extent, const glm::mat4& view, const glm::vec3& eyePos);
+
+	Cave& cave;
+	ViewBlock& viewBlock;
+	int firstSlot;
+	WallStats& stats;
+	float nearPlane, farPlane;
+
+	std::unique_ptr<WallRing> rings[EYES];
+	// Skips the pass of an eye while its inputs don't change
+	WallCache caches[EYES];
+	WallFrame frames[EYES][Cave::MAX_WALLS];
+	// Warp from the views of the wall images to the latest pass of each eye
+	Cave::Reprojection reprojection[EYES];
+	// Insets of the latest pass of each eye and their projections
+	Cave::Insets insets[EYES];
+	glm::mat4 insetProjections[EYES][Cave::MAX_WALLS];
+	// Analytic skybox mode: the skybox each eye's walls show behind the cubes
+	Cave::Sky sky[EYES];
+
+	// Layered pass, draws every wall in one submission
+	GLuint program;
+	Uniform<GLint> uWallMask{ "wallMask" }, uWallCount{ "wallCount" }, uLayerOffset{ "layerOffset" }, uOnFarPlane{ "onFarPlane" };
+	// Draws of the pass, sorted before they run
+	RenderQueue queue;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "WallRing.h"
+
+WallRing::WallRing(int count, GLsizei size, GLsizei layers, GLenum colorFormat) :
+	stalls(0), fences(count, (GLsync)0), index(0)
+{
+	for (int i = 0; i < count; i++) {
+		targets.push_back(std::make_unique<WallTarget>(size, layers, colorFormat));
+	}
+}
+
+WallRing::~WallRing()
+{
+	for (GLsync sync : fences) {
+		if (sync) {
+			glDeleteSync(sync);
+		}
+	}
+}
+
+WallTarget& WallRing::advance()
+{
+	int next = (index + 1) % (int)targets.size();
+	if (fences[next]) {
+		GLenum result = glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			stalls++;
+			// One second, the frame is lost long before that
+			glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+		glDeleteSync(fences[next]);
+		fences[next] = 0;
+	}
+
+	targets[next]->extent = targets[index]->extent;
+	index = next;
+	return *targets[index];
+}
+
+void WallRing::fence()
+{
+	if (fences[index]) {
+		glDeleteSync(fences[index]);
+	}
+	fences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t WallRing::memoryBytes() const
+{
+	size_t bytes = 0;
+	for (const std::unique_ptr<WallTarget>& target : targets) {
+		bytes += target->memoryBytes();
+	}
+	return bytes;
+}
@@ -0,0 +1,47 @@
+#ifndef _WALLRING_H
+#define _WALLRING_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+
+#include "WallTarget.h"
+#include <memory>
+#include <vector>
+
+// Ring of wall targets for one eye. A new wall pass renders into the next
+// target while the GPU may still be sampling the previous one, so the wall
+// and HMD passes of consecutive frames don't have to serialize. A fence after
+// the last read of each target tells when it can be written again.
+class WallRing
+{
+public:
+	// Every target has its own depth array, a pass into one target never waits on the
+	// depth writes of the pass before it
+	WallRing(int count, GLsizei size, GLsizei layers, GLenum colorFormat);
+	~WallRing();
+
+	// Target holding the latest wall images
+	WallTarget& current() { return *targets[index]; }
+	// Move to the next target for a new wall pass, blocks until the GPU is done reading it.
+	// The extent of the current target carries over.
+	WallTarget& advance();
+	// Call after the commands sampling the current target have been submitted
+	void fence();
+
+	size_t memoryBytes() const;
+
+	// Times advance had to wait for the GPU
+	unsigned int stalls;
+
+private:
+	std::vector<std::unique_ptr<WallTarget>> targets;
+	std::vector<GLsync> fences;
+	int index;
+};
+
+#endif
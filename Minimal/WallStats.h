@@ -0,0 +1,41 @@
+#ifndef _WALLSTATS_H
+#define _WALLSTATS_H
+
+// Per-frame wall pass and eye buffer counters for telemetry, summed over both eyes
+struct WallStats {
+	// Eye buffer scale and smoothed GPU time, 0 without dynamic resolution
+	float eyeScale = 0.0f;
+	float gpuMilliseconds = 0.0f;
+	unsigned int scaleChanges = 0; // dynamic resolution scale changes
+	unsigned int wallsRendered = 0; // drawn this frame
+	unsigned int wallsCached = 0; // visible but reused from the wall cache
+	unsigned int wallsCulled = 0; // outside the HMD frustum, skipped
+	unsigned int wallsReprojected = 0; // visible, warped from an older image in amortized mode
+	unsigned int insetsRendered = 0; // foveal insets drawn in foveated mode
+	unsigned int instancesDrawn = 0; // cube draws issued to the wall pass
+	unsigned int instancesCulled = 0; // cubes outside every enabled wall frustum
+
+	WallStats& operator+=(const WallStats& other) {
+		eyeScale += other.eyeScale;
+		gpuMilliseconds += other.gpuMilliseconds;
+		scaleChanges += other.scaleChanges;
+		wallsRendered += other.wallsRendered;
+		wallsCached += other.wallsCached;
+		wallsCulled += other.wallsCulled;
+		wallsReprojected += other.wallsReprojected;
+		insetsRendered += other.insetsRendered;
+		instancesDrawn += other.instancesDrawn;
+		instancesCulled += other.instancesCulled;
+		return *this;
+	}
+};
+
+// Set bits of a wall mask
+inline int bitCount(int mask)
+{
+	int count = 0;
+	for (; mask; mask &= mask - 1) count++;
+	return count;
+}
+
+#endif
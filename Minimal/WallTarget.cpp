@@ -0,0 +1,159 @@
+#include "WallTarget.h"
+#include "GLState.h"
+#include <iostream>
+
+WallTarget::WallTarget(GLsizei size, GLsizei layers, GLenum colorFormat) :
+	size(size), layers(layers), colorFormat(colorFormat), extent(layers, glm::ivec2(size)),
+	visible(layers, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f))
+{
+	// Upload format matching the internal format, no data is uploaded
+	GLenum format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+	if (colorFormat == GL_R11F_G11F_B10F) {
+		format = GL_RGB;
+		type = GL_UNSIGNED_INT_10F_11F_11F_REV;
+	}
+	else if (colorFormat == GL_RGB565) {
+		format = GL_RGB;
+		type = GL_UNSIGNED_SHORT_5_6_5;
+	}
+
+	// Color array
+	glGenTextures(1, &colorTexture);
+	GLState::bindTexture(GL_TEXTURE_2D_ARRAY, colorTexture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, colorFormat, size, size, layers, 0, format, type, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Depth array, a renderbuffer can't be attached as a layered image
+	glGenTextures(1, &depthTexture);
+	GLState::bindTexture(GL_TEXTURE_2D_ARRAY, depthTexture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	GLState::bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// Attach both arrays as layered images
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorTexture, 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "wall framebuffer incomplete" << std::endl;
+	}
+
+	// Per-layer framebuffers
+	layerFBO.resize(layers);
+	glGenFramebuffers(layers, &layerFBO[0]);
+	for (GLsizei i = 0; i < layers; i++) {
+		glBindFramebuffer(GL_FRAMEBUFFER, layerFBO[i]);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorTexture, 0, i);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, i);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+WallTarget::~WallTarget()
+{
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteFramebuffers(layers, &layerFBO[0]);
+	GLState::deleteTextures(1, &colorTexture);
+	GLState::deleteTextures(1, &depthTexture);
+}
+
+void WallTarget::bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	// wall.geom routes wall i to viewport i, the scissor rectangles are per viewport as well
+	for (GLsizei i = 0; i < layers; i++) {
+		GLState::viewportIndexed(i, 0.0f, 0.0f, (GLfloat)extent[i].x, (GLfloat)extent[i].y);
+		glm::ivec4 rect = scissorRect(i);
+		glScissorIndexed(i, rect.x, rect.y, rect.z, rect.w);
+	}
+	GLState::enable(GL_SCISSOR_TEST);
+}
+
+void WallTarget::unbind()
+{
+	GLState::disable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void WallTarget::clear(int mask)
+{
+	// A layered clear would hit every wall, clear the selected layers one by one.
+	// Clears only use scissor 0, glScissor sets all of them, so bind restores them after.
+	GLState::enable(GL_SCISSOR_TEST);
+	for (GLsizei i = 0; i < layers; i++) {
+		if ((mask & (1 << i)) == 0) {
+			continue;
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, layerFBO[i]);
+		glm::ivec4 rect = scissorRect(i);
+		glScissor(rect.x, rect.y, rect.z, rect.w);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+	bind();
+}
+
+glm::vec2 WallTarget::uvScale(int layer) const
+{
+	return glm::vec2(extent[layer]) / (float)size;
+}
+
+glm::ivec4 WallTarget::scissorRect(int layer) const
+{
+	const glm::vec4& uv = visible[layer];
+	if (uv.z <= uv.x || uv.w <= uv.y) {
+		return glm::ivec4(0);
+	}
+	glm::vec2 texels(extent[layer]);
+	glm::ivec2 lower = glm::max(glm::ivec2(glm::floor(glm::vec2(uv.x, uv.y) * texels)) - 1, glm::ivec2(0));
+	glm::ivec2 upper = glm::min(glm::ivec2(glm::ceil(glm::vec2(uv.z, uv.w) * texels)) + 1, extent[layer]);
+	glm::ivec2 size = glm::max(upper - lower, glm::ivec2(0));
+	return glm::ivec4(lower, size);
+}
+
+void WallTarget::invalidateDepth()
+{
+	// Depth is only needed while the pass runs, let tiled and compressing GPUs skip the store
+	if (GLEW_ARB_invalidate_subdata) {
+		const GLenum attachment = GL_DEPTH_ATTACHMENT;
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &attachment);
+	}
+}
+
+size_t WallTarget::memoryBytes() const
+{
+	size_t texels = (size_t)size * size * layers;
+	return texels * (bytesPerTexel(colorFormat) + bytesPerTexel(GL_DEPTH_COMPONENT24));
+}
+
+size_t WallTarget::bytesPerTexel(GLenum internalFormat)
+{
+	switch (internalFormat) {
+	case GL_RGB565:
+		return 2;
+	case GL_RGB8: // padded to 32 bits by the drivers we run on
+	case GL_RGBA8:
+	case GL_R11F_G11F_B10F:
+	case GL_DEPTH_COMPONENT24: // stored as 24 bit depth in a 32 bit word
+		return 4;
+	default:
+		return 4;
+	}
+}
+
+const char* WallTarget::formatName(GLenum internalFormat)
+{
+	switch (internalFormat) {
+	case GL_RGBA8:
+		return "RGBA8";
+	case GL_R11F_G11F_B10F:
+		return "R11G11B10F";
+	case GL_RGB565:
+		return "RGB565";
+	default:
+		return "unknown";
+	}
+}
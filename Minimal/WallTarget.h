@@ -0,0 +1,68 @@
+#ifndef _WALLTARGET_H
+#define _WALLTARGET_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+#include <vector>
+
+// Layered render target holding one image per CAVE wall.
+// Color and depth are 2D texture arrays attached as layered images, so a
+// geometry shader writing gl_Layer can fill every wall in a single submission.
+class WallTarget
+{
+public:
+	// colorFormat is GL_RGBA8, GL_R11F_G11F_B10F or GL_RGB565
+	WallTarget(GLsizei size, GLsizei layers, GLenum colorFormat = GL_RGBA8);
+	~WallTarget();
+
+	// Bind the layered framebuffer, set viewport i to extent[i] of layer i and
+	// scissor it to the visible part of the layer
+	void bind();
+	// Clear the visible part of the layers in mask, leaves the layered framebuffer bound
+	void clear(int mask);
+	// Stop scissoring once the wall pass is done
+	void unbind();
+
+	// Tell the driver the depth of the last pass isn't needed anymore
+	void invalidateDepth();
+
+	// UV scale that maps a wall's 0..1 coordinates onto its extent
+	glm::vec2 uvScale(int layer) const;
+	// Texel rectangle (x, y, width, height) of a layer's visible part, with a texel
+	// of margin for filtering
+	glm::ivec4 scissorRect(int layer) const;
+
+	// Video memory allocated by this target, color and depth
+	size_t memoryBytes() const;
+
+	static size_t bytesPerTexel(GLenum internalFormat);
+	static const char* formatName(GLenum internalFormat);
+
+	GLuint FBO;
+	// One framebuffer per layer, so single walls can be cleared
+	std::vector<GLuint> layerFBO;
+	GLuint colorTexture; // GL_TEXTURE_2D_ARRAY, one layer per wall
+	GLuint depthTexture; // GL_TEXTURE_2D_ARRAY, one layer per wall
+
+	GLsizei size, layers;
+	GLenum colorFormat;
+
+	// Lower left sub-rectangle of each layer holding the current image,
+	// lets walls render below full resolution without reallocating
+	std::vector<glm::ivec2> extent;
+	// uv rectangle (u0, v0, u1, v1) of each layer that gets shaded, the rest of
+	// the extent is never sampled and keeps whatever it held
+	std::vector<glm::vec4> visible;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "WallView.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+glm::mat4 WallView::projection(const glm::vec3& eyePos, const Cave::Wall& wall, float n, float f)
+{
+	glm::vec3 va = wall.pa - eyePos;
+	glm::vec3 vb = wall.pb - eyePos;
+	glm::vec3 vc = wall.pc - eyePos;
+
+	float d = -glm::dot(wall.vn, va);
+	float l = glm::dot(wall.vr, va) * n / d;
+	float r = glm::dot(wall.vr, vb) * n / d;
+	float b = glm::dot(wall.vu, va) * n / d;
+	float t = glm::dot(wall.vu, vc) * n / d;
+
+	glm::mat4 P = glm::frustum(l, r, b, t, n, f);
+
+	glm::mat4 T = glm::translate(glm::vec3(-eyePos.x, -eyePos.y, -eyePos.z));
+
+	return P * wall.rotation * T;
+}
+
+bool WallView::visible(const glm::mat4& viewProjection, const Cave::Wall& wall)
+{
+	glm::vec4 clip[4];
+	clip[0] = viewProjection * glm::vec4(wall.pa, 1.0f);
+	clip[1] = viewProjection * glm::vec4(wall.pb, 1.0f);
+	clip[2] = viewProjection * glm::vec4(wall.pc, 1.0f);
+	clip[3] = viewProjection * glm::vec4(wall.pb + (wall.pc - wall.pa), 1.0f);
+
+	// Clip space planes -w <= x, y, z <= w
+	for (int axis = 0; axis < 3; axis++) {
+		int below = 0, above = 0;
+		for (int i = 0; i < 4; i++) {
+			if (clip[i][axis] < -clip[i].w) below++;
+			if (clip[i][axis] > clip[i].w) above++;
+		}
+		if (below == 4 || above == 4) {
+			return false;
+		}
+	}
+	return true;
+}
+
+glm::vec4 WallView::visibleRect(const Frustum& frustum, const Cave::Wall& wall)
+{
+	std::vector<glm::vec3> polygon = { wall.pa, wall.pb, wall.pb + (wall.pc - wall.pa), wall.pc };
+	frustum.clip(polygon);
+	if (polygon.empty()) {
+		return glm::vec4(0.0f);
+	}
+
+	glm::vec3 u = wall.pb - wall.pa, v = wall.pc - wall.pa;
+	glm::vec2 lower(1.0f), upper(0.0f);
+	for (const glm::vec3& point : polygon) {
+		glm::vec2 uv(glm::dot(point - wall.pa, u) / glm::dot(u, u), glm::dot(point - wall.pa, v) / glm::dot(v, v));
+		lower = glm::min(lower, uv);
+		upper = glm::max(upper, uv);
+	}
+	lower = glm::clamp(glm::floor(lower * (float)VISIBLE_GRID) / (float)VISIBLE_GRID, glm::vec2(0.0f), glm::vec2(1.0f));
+	upper = glm::clamp(glm::ceil(upper * (float)VISIBLE_GRID) / (float)VISIBLE_GRID, glm::vec2(0.0f), glm::vec2(1.0f));
+	return glm::vec4(lower, upper);
+}
+
+glm::ivec2 WallView::resolution(const glm::mat4& viewProjection, const glm::ivec2& viewportSize, const Cave::Wall& wall)
+{
+	glm::vec3 corners[4] = { wall.pa, wall.pb, wall.pc, wall.pb + (wall.pc - wall.pa) };
+	glm::vec2 screen[4];
+	for (int i = 0; i < 4; i++) {
+		glm::vec4 clip = viewProjection * glm::vec4(corners[i], 1.0f);
+		// A corner behind the eye has no finite footprint, keep full resolution
+		if (clip.w <= 0.0f) {
+			return wall.resolution;
+		}
+		screen[i] = (glm::vec2(clip.x, clip.y) / clip.w * 0.5f + 0.5f) * glm::vec2(viewportSize);
+	}
+
+	// Longest projected edge along u (pa-pb, pc-pd) and along v (pa-pc, pb-pd)
+	float u = std::max(glm::length(screen[1] - screen[0]), glm::length(screen[3] - screen[2]));
+	float v = std::max(glm::length(screen[2] - screen[0]), glm::length(screen[3] - screen[1]));
+
+	return glm::ivec2(quantize(u, wall.resolution.x), quantize(v, wall.resolution.y));
+}
+
+int WallView::quantize(float texels, int maxSize)
+{
+	int size = (int)std::ceil(texels / SIZE_STEP) * SIZE_STEP;
+	return std::min(std::max(size, (int)MIN_SIZE), maxSize);
+}
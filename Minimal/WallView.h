@@ -0,0 +1,46 @@
+#ifndef _WALLVIEW_H
+#define _WALLVIEW_H
+
+#define GLFW_INCLUDE_GLEXT
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#else
+#include <GL/glew.h>
+#endif
+#include <GLFW/glfw3.h>
+// Use of degrees is deprecated. Use radians instead.
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "Cave.h"
+#include "Frustum.h"
+
+// A cave wall as seen from an eye: its off-axis projection, whether and where an
+// HMD eye sees it and the wall image resolution matching the HMD pixels it covers.
+class WallView
+{
+public:
+	enum {
+		// Smallest wall resolution and the step it is rounded up to
+		MIN_SIZE = 128,
+		SIZE_STEP = 64,
+		// Grid the visible part of a wall snaps out to
+		VISIBLE_GRID = 32
+	};
+
+	// Off-axis projection through a wall, the wall basis comes precomputed from Cave::updateWalls
+	static glm::mat4 projection(const glm::vec3& eyePos, const Cave::Wall& wall, float n, float f);
+	// False when all four corners of a wall lie outside the same plane of the HMD eye frustum
+	static bool visible(const glm::mat4& viewProjection, const Cave::Wall& wall);
+	// uv rectangle of the part of a wall inside an HMD eye frustum, empty if the eye sees none of it.
+	// Snapped out to VISIBLE_GRID so small head motion keeps the wall cache valid.
+	static glm::vec4 visibleRect(const Frustum& frustum, const Cave::Wall& wall);
+	// Texels a wall needs along its two edges to match the HMD pixels it covers in a viewport of viewportSize
+	static glm::ivec2 resolution(const glm::mat4& viewProjection, const glm::ivec2& viewportSize, const Cave::Wall& wall);
+	// Round up to SIZE_STEP so small head motion doesn't change the resolution every frame
+	static int quantize(float texels, int maxSize);
+};
+
+#endif
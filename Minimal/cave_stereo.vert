@@ -0,0 +1,21 @@
+#version 410 core
+// Vertex stage of the stereo CAVE pass, cave_stereo.geom projects to each eye.
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 vertexUV;
+layout (location = 2) in int wallIndex;
+
+// Places the cave in the world the walls are projected in
+uniform mat4 view;
+
+out vec2 vUV;
+out vec3 vWallPos;
+flat out int vWall;
+
+void main()
+{
+    gl_Position = view * vec4(position, 1.0);
+    vUV = vertexUV;
+    vWallPos = gl_Position.xyz;
+    vWall = wallIndex;
+}
@@ -9,8 +9,18 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 
+// Matches ViewBlock::MAX_WALLS
+#define MAX_WALLS 6
+// Per view camera data, see ViewBlock.h
+layout (std140) uniform PerView {
+    mat4 eyeProjection;
+    mat4 eyeView;
+    mat4 wallProjection[MAX_WALLS];
+    vec4 eyePosition;
+};
+
 // Uniform variables can be updated by fetching their location and passing values to that location
-uniform mat4 projection;
+// Cursor to world, the eye comes from PerView
 uniform mat4 modelview;
 
 // Outputs of the vertex shader are the inputs of the same name of the fragment shader.
@@ -21,6 +31,6 @@ out vec3 vertNormal;
 void main()
 {
     // OpenGL maintains the D matrix so you only need to multiply by P, V (aka C inverse), and M
-    gl_Position = projection * modelview * vec4(position.x, position.y, position.z, 1.0);
+    gl_Position = eyeProjection * eyeView * modelview * vec4(position.x, position.y, position.z, 1.0);
     vertNormal = normal;
 }
@@ -0,0 +1,16 @@
+#version 410 core
+// Vertex stage of the stereo cursor pass, cursor_stereo.geom projects to each eye.
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+
+// Model to world, Mesh::Draw sets it from the identity view
+uniform mat4 modelview;
+
+out vec3 vNormal;
+
+void main()
+{
+    gl_Position = modelview * vec4(position, 1.0);
+    vNormal = normal;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+// Hidden area of an eye viewport, already in NDC. Placed on the near plane so
+// every later draw there fails the depth test.
+
+layout (location = 0) in vec2 position;
+
+void main()
+{
+    gl_Position = vec4(position, -1.0, 1.0);
+}
@@ -5,17 +5,26 @@ layout (location = 2) in vec2 texCoords;
 
 out vec2 TexCoords;
 
-uniform mat4 model;
+// Matches ViewBlock::MAX_WALLS
+#define MAX_WALLS 6
+// Per view camera data, see ViewBlock.h
+layout (std140) uniform PerView {
+    mat4 eyeProjection;
+    mat4 eyeView;
+    mat4 wallProjection[MAX_WALLS];
+    vec4 eyePosition;
+};
+
+// Line to world
 uniform mat4 view;
-uniform mat4 projection;
 
 out vec3 Normal;
 out vec3 FragPos;
 
 void main()
 {
-    gl_Position = projection * model * view * vec4(position, 1.0f);
+    gl_Position = eyeProjection * eyeView * view * vec4(position, 1.0f);
     TexCoords = texCoords;
-    FragPos = vec3(model * view * vec4(position.x, position.y, position.z, 1.0));
-    Normal = mat3(transpose(inverse(model * view))) * normal;
+    FragPos = vec3(eyeView * view * vec4(position.x, position.y, position.z, 1.0));
+    Normal = mat3(transpose(inverse(eyeView * view))) * normal;
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 410 core
+// Vertex stage of the stereo line pass, line_stereo.geom projects to each eye.
+
+layout (location = 0) in vec3 position;
+
+// Line to world
+uniform mat4 view;
+
+void main()
+{
+    gl_Position = view * vec4(position, 1.0);
+}
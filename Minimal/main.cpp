@@ -21,6 +21,8 @@ limitations under the License.
 #include <iostream>
 #include <memory>
 #include <exception>
+#include <vector>
+#include <string>
 #include <algorithm>
 
 #include <Windows.h>
@@ -148,6 +150,7 @@ void glDebugCallbackHandler(GLenum source, GLenum type, GLuint id, GLenum severi
 //
 
 #include <GLFW/glfw3.h>
+#include "GLState.h"
 
 namespace glfw {
 	inline GLFWwindow * createWindow(const uvec2 & size, const ivec2 & position = ivec2(INT_MIN)) {
@@ -287,7 +290,7 @@ protected:
 
 protected:
 	virtual void viewport(const ivec2 & pos, const uvec2 & size) {
-		glViewport(pos.x, pos.y, size.x, size.y);
+		GLState::viewport(pos.x, pos.y, size.x, size.y);
 	}
 
 private:
@@ -314,6 +317,12 @@ private:
 
 #include <OVR_CAPI.h>
 #include <OVR_CAPI_GL.h>
+#include "EyeBufferConfig.h"
+#include "LensMask.h"
+#include "DynamicResolution.h"
+#include "MultiResTarget.h"
+#include "ViewSet.h"
+#include "RenderQueue.h"
 
 namespace ovr {
 
@@ -441,6 +450,18 @@ private:
 	// Default Eye Offset
 	float defaultHmdToEyeOffset[2]; 
 
+	// How the eye passes are drawn, set by configureEyeBuffer
+	EyeBufferConfig _eyeBuffer;
+	// Hidden area of each eye viewport, null without a mask
+	std::unique_ptr<LensMask> _lensMask;
+
+	// Full eye viewport sizes, the swap chain holds them side by side
+	ovrSizei _eyeSizes[2];
+	// Scales the eye viewports to the GPU budget, null keeps them at full size
+	std::unique_ptr<DynamicResolution> _dynamicResolution;
+	// Multi-resolution eye pass target, null renders the eye buffer directly
+	std::unique_ptr<MultiResTarget> _multiRes;
+
 public:
 
 	RiftApp() {
@@ -464,6 +485,7 @@ public:
 			ovrFovPort & fov = _sceneLayer.Fov[eye] = _eyeRenderDescs[eye].Fov;
 			auto eyeSize = ovr_GetFovTextureSize(_session, eye, fov, 1.0f);
 			_sceneLayer.Viewport[eye].Size = eyeSize;
+			_eyeSizes[eye] = eyeSize;
 			_sceneLayer.Viewport[eye].Pos = { (int)_renderTargetSize.x, 0 };
 
 			_renderTargetSize.y = std::max(_renderTargetSize.y, (uint32_t)eyeSize.h);
@@ -508,22 +530,23 @@ protected:
 		for (int i = 0; i < length; ++i) {
 			GLuint chainTexId;
 			ovr_GetTextureSwapChainBufferGL(_session, _eyeTexture, i, &chainTexId);
-			glBindTexture(GL_TEXTURE_2D, chainTexId);
+			GLState::bindTexture(GL_TEXTURE_2D, chainTexId);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		}
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::bindTexture(GL_TEXTURE_2D, 0);
 
 		// Set up the framebuffer object
 		glGenFramebuffers(1, &_fbo);
 		glGenRenderbuffers(1, &_depthBuffer);
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
 		glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, _renderTargetSize.x, _renderTargetSize.y);
+		// Stencil for the CAVE portal mode
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _renderTargetSize.x, _renderTargetSize.y);
 		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+		glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 
 		ovrMirrorTextureDesc mirrorDesc;
@@ -552,6 +575,12 @@ protected:
 
 	void draw() final override {
 
+		// The compositor calls that ended the last frame may have changed GL state behind GLState's back
+		GLState::invalidate();
+
+		if (_dynamicResolution) {
+			scaleEyeViewports();
+		}
 		ovrPosef eyePoses[2];
 		ovr_GetEyePoses(_session, frame, true, _viewScaleDesc.HmdToEyeOffset, eyePoses, &_sceneLayer.SensorSampleTime);
 		int curIndex;
@@ -560,8 +589,73 @@ protected:
 		ovr_GetTextureSwapChainBufferGL(_session, _eyeTexture, curIndex, &curTexId);
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
 		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, curTexId, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		// The multi-resolution pass masks its own target instead
+		if (_lensMask && !_multiRes) {
+			maskLenses();
+		}
 
+		// Both eyes' view-projections, for per-frame work shared by the eye passes
+		mat4 eyeViewProjections[2];
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			eyeViewProjections[eye] = _eyeProjections[eye] * glm::inverse(ovr::toGlm(eyePoses[eye]));
+		});
+		beginFrame(eyeViewProjections);
+
+		// Stereo and multi-resolution mode run both wall passes first, then draw the eyes through view sets
+		mat4 renderPoses[2];
+		renderEyes(eyePoses, renderPoses, _eyeBuffer.stereo || _multiRes);
+		if (_multiRes) {
+			renderMultiRes(renderPoses);
+		}
+		else if (_eyeBuffer.stereo) {
+			renderStereo(renderPoses);
+		}
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		endFrame();
+		if (_dynamicResolution) {
+			_dynamicResolution->endFrame();
+		}
+		ovr_CommitTextureSwapChain(_session, _eyeTexture);
+		// Layers are composited in order, anything the app adds goes under the eye buffer
+		std::vector<const ovrLayerHeader*> layers;
+		underlayLayers(layers);
+		layers.push_back(&_sceneLayer.Header);
+		ovr_SubmitFrame(_session, frame, &_viewScaleDesc, layers.data(), (unsigned int)layers.size());
+
+		GLuint mirrorTextureId;
+		ovr_GetMirrorTextureBufferGL(_session, _mirrorTexture, &mirrorTextureId);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _mirrorFbo);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mirrorTextureId, 0);
+		glBlitFramebuffer(0, 0, _mirrorSize.x, _mirrorSize.y, 0, _mirrorSize.y, _mirrorSize.x, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	}
+
+	// Dynamic resolution: the compositor reads each eye from its viewport, a smaller one renders
+	// fewer pixels at the same field of view
+	void scaleEyeViewports() {
+		float scale = _dynamicResolution->scale();
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			_sceneLayer.Viewport[eye].Size.w = std::max(1, (int)(_eyeSizes[eye].w * scale + 0.5f));
+			_sceneLayer.Viewport[eye].Size.h = std::max(1, (int)(_eyeSizes[eye].h * scale + 0.5f));
+		});
+		_dynamicResolution->beginFrame();
+	}
+
+	// Lay the lens mask into both eyes' depth. Nothing clears the eye buffer's depth again this
+	// frame, the mask holds for both eye passes.
+	void maskLenses() {
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			const auto& vp = _sceneLayer.Viewport[eye];
+			GLState::viewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
+			_lensMask->draw(eye);
+		});
+	}
+
+	// Per eye: the eye position after freeze mode, the wall passes and, unless views is set, the
+	// eye pass. renderPoses gets the pose each eye is drawn from.
+	void renderEyes(const ovrPosef eyePoses[2], mat4 renderPoses[2], bool views) {
 		ovr::for_each_eye([&](ovrEyeType eye) {
 	
 			// Init Eye
@@ -583,28 +677,119 @@ protected:
 			currentEye(eye);
 
 			const auto& vp = _sceneLayer.Viewport[eye];
-			glViewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
+			GLState::viewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
 			_sceneLayer.RenderPose[eye] = eyePoses[eye];
 
 			glm::vec3 eyePos = glm::vec3(currEye[eye].Position.x, currEye[eye].Position.y, currEye[eye].Position.z);
-			offscreenRender(_eyeProjections[eye], ovr::toGlm(currEye[eye]), _fbo, vp, eyePos);
+			offscreenRender(_eyeProjections[eye], ovr::toGlm(currEye[eye]), ovr::toGlm(eyePoses[eye]), _fbo, vp, eyePos);
+			renderPoses[eye] = ovr::toGlm(eyePoses[eye]);
+			if (views) {
+				return;
+			}
 			glm::vec3 origEyePos = glm::vec3(eyePoses[eye].Position.x, eyePoses[eye].Position.y, eyePoses[eye].Position.z);
 			// Render scene
-			renderScene(_eyeProjections[eye], ovr::toGlm(eyePoses[eye]), origEyePos);
+			renderScene(_eyeProjections[eye], renderPoses[eye], origEyePos);
 			
 		});
-		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		ovr_CommitTextureSwapChain(_session, _eyeTexture);
-		ovrLayerHeader* headerList = &_sceneLayer.Header;
-		ovr_SubmitFrame(_session, frame, &_viewScaleDesc, &headerList, 1);
+	}
 
-		GLuint mirrorTextureId;
-		ovr_GetMirrorTextureBufferGL(_session, _mirrorTexture, &mirrorTextureId);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, _mirrorFbo);
-		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mirrorTextureId, 0);
-		glBlitFramebuffer(0, 0, _mirrorSize.x, _mirrorSize.y, 0, _mirrorSize.y, _mirrorSize.x, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	// Multi-resolution mode: one view per region of an eye, upsampled into the eye's viewport
+	void renderMultiRes(const mat4 renderPoses[2]) {
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			const auto& vp = _sceneLayer.Viewport[eye];
+			_multiRes->bind(eye, ivec2(vp.Size.w, vp.Size.h));
+			if (_lensMask) {
+				// The mask has no view geometry shader, it is drawn once per region
+				for (int i = 0; i < MultiResTarget::REGIONS; i++) {
+					_multiRes->useRegion(i);
+					_lensMask->draw(eye);
+				}
+				_multiRes->useRegions();
+			}
+			ViewSet regions;
+			for (int i = 0; i < MultiResTarget::REGIONS; i++) {
+				regions.add(_eyeProjections[eye], glm::inverse(renderPoses[eye]), eye, _multiRes->regionRect(eye, i));
+			}
+			renderSceneViews(regions);
+
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+			GLState::viewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
+			_multiRes->composite(ivec2(vp.Pos.x, vp.Pos.y));
+		});
+	}
+
+	// Stereo mode: both eyes in one pass, viewport i is eye i's half of the eye buffer
+	void renderStereo(const mat4 renderPoses[2]) {
+		ViewSet eyes;
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			const auto& vp = _sceneLayer.Viewport[eye];
+			GLState::viewportIndexed(eye, (GLfloat)vp.Pos.x, (GLfloat)vp.Pos.y, (GLfloat)vp.Size.w, (GLfloat)vp.Size.h);
+			eyes.add(_eyeProjections[eye], glm::inverse(renderPoses[eye]), eye);
+		});
+		renderSceneViews(eyes);
+	}
+
+	// Each eye's field of view as tangents (up, down, left, right)
+	void eyeFovTangents(glm::vec4 fov[2]) const {
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			const ovrFovPort & port = _eyeRenderDescs[eye].Fov;
+			fov[eye] = glm::vec4(port.UpTan, port.DownTan, port.LeftTan, port.RightTan);
+		});
+	}
+
+	// Draw the eye passes the way config asks from now on, config has to be resolved against the scene
+	void configureEyeBuffer(const EyeBufferConfig & config) {
+		_eyeBuffer = config;
+		if (config.dynamicResolution > 0.0f) {
+			enableDynamicResolution(config.dynamicResolution);
+		}
+		if (config.multiRes()) {
+			enableMultiRes(config.multiResCenter, config.multiResDensity);
+		}
+		if (config.lensMask > 0.0f) {
+			enableLensMask(config.lensMask);
+		}
+	}
+
+	const EyeBufferConfig & eyeBuffer() const { return _eyeBuffer; }
+
+	// Mask the eye buffer pixels outside the lenses from now on, see LensMask for scale
+	void enableLensMask(float scale) {
+		glm::vec4 fov[2];
+		eyeFovTangents(fov);
+		_lensMask = std::make_unique<LensMask>(fov, scale);
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			const ovrSizei & size = _sceneLayer.Viewport[eye].Size;
+			float hidden = _lensMask->hiddenFraction(eye);
+			std::cout << "lens mask: eye " << eye << " hides " << (int)(hidden * size.w * size.h) << " of " << size.w * size.h
+				<< " pixels (" << (int)(hidden * 100.0f + 0.5f) << "%)" << std::endl;
+		});
+	}
+
+	// Null unless enableDynamicResolution was called
+	const DynamicResolution * dynamicResolution() const { return _dynamicResolution.get(); }
+
+	// Scale the eye viewports to hold the GPU time of a frame under budget, no further down than minScale
+	void enableDynamicResolution(float minScale) {
+		// Leave the compositor part of the refresh interval
+		float budgetMs = 0.9f * 1000.0f / _hmdDesc.DisplayRefreshRate;
+		_dynamicResolution = std::make_unique<DynamicResolution>(budgetMs, minScale);
+		std::cout << "dynamic resolution: " << budgetMs << " ms GPU budget, eye viewports scale down to " << minScale << std::endl;
+	}
+
+	// Render the eyes in 3x3 regions from now on, full density within centerTangent of the
+	// optical axis and outerDensity per axis outside. Needs renderSceneViews.
+	void enableMultiRes(float centerTangent, float outerDensity) {
+		glm::vec4 fov[2];
+		eyeFovTangents(fov);
+		ivec2 maxSize(std::max(_eyeSizes[0].w, _eyeSizes[1].w), std::max(_eyeSizes[0].h, _eyeSizes[1].h));
+		_multiRes = std::make_unique<MultiResTarget>(fov, maxSize, centerTangent, outerDensity);
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			int pixels = _eyeSizes[eye].w * _eyeSizes[eye].h;
+			float shaded = _multiRes->shadedFraction(eye);
+			std::cout << "multi-resolution: eye " << eye << " shades " << (int)(shaded * pixels) << " of " << pixels
+				<< " pixels (" << (int)(shaded * 100.0f + 0.5f) << "%)" << std::endl;
+		});
 	}
 
 	// Get Default Eye Index
@@ -613,13 +798,25 @@ protected:
 		return defaultHmdToEyeOffset[eyeIdx]; 
 	}
 
-	virtual void offscreenRender(const glm::mat4 & projection, const glm::mat4 & headPose, GLuint _fbo, const ovrRecti & vp, const glm::vec3 & eyePos) = 0;
+	// headPose is the (possibly frozen) pose the walls are rendered from, hmdPose the live pose the eye buffer is viewed from
+	virtual void offscreenRender(const glm::mat4 & projection, const glm::mat4 & headPose, const glm::mat4 & hmdPose, GLuint _fbo, const ovrRecti & vp, const glm::vec3 & eyePos) = 0;
 
 	virtual void renderScene(const glm::mat4 & projection, const glm::mat4 & headPose, const glm::vec3 & eyePos) = 0;
 
+	// Stereo and multi-resolution mode: renderSceneViews replaces the renderScene calls once both eyes'
+	// offscreenRender ran, view i of views renders to viewport i
+	virtual void renderSceneViews(const ViewSet & views) {}
+
 	virtual void currentEye(ovrEyeType eye) = 0;
 
+	virtual void beginFrame(const glm::mat4 eyeViewProjections[2]) = 0;
+	// After the eye passes of a frame, before the eye buffer is committed
+	virtual void endFrame() {}
+
 	virtual int FreezeMode() = 0;
+
+	// Layers shown through the parts of the eye buffer left at alpha 0
+	virtual void underlayLayers(std::vector<const ovrLayerHeader*> & layers) {}
 	
 };
 
@@ -633,37 +830,149 @@ protected:
 
 #include <time.h>
 #include "Shader.h"
+#include "Program.h"
+#include "ViewBlock.h"
+#include "StreamBuffer.h"
 #include "Cube.h"
 #include "TexturedCube.h"
 #include "Skybox.h"
 #include "Cave.h"
+#include "QuadLayers.h"
 #include "Line.h"
+#include "WallTarget.h"
+#include "WallRing.h"
+#include "WallCache.h"
+#include "WallStats.h"
+#include "WallView.h"
+#include "WallContent.h"
+#include "WallPass.h"
+#include "PortalPass.h"
+#include "QuadWallPass.h"
+#include "ViewSetPass.h"
+#include "Frustum.h"
 #include <vector>
 #include "Model.h"
 #include "Mesh.h"
 
+// Quad layers backed by SDK swap chains, the compositor resamples them at display resolution
+class RiftQuadLayers : public QuadLayers {
+
+	ovrSession session;
+	std::vector<ovrTextureSwapChain> chains;
+	std::vector<ovrLayerQuad> layers;
+	std::vector<bool> committed;
+
+public:
+	RiftQuadLayers(ovrSession session, int count, GLsizei size) :
+		QuadLayers(count, size), session(session), chains(count), layers(count), committed(count, false) {
+
+		// Same format as the eye buffer, the wall images hold the values the eye pass would have written
+		ovrTextureSwapChainDesc desc = {};
+		desc.Type = ovrTexture_2D;
+		desc.ArraySize = 1;
+		desc.Width = size;
+		desc.Height = size;
+		desc.MipLevels = 1;
+		desc.Format = OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
+		desc.SampleCount = 1;
+		desc.StaticImage = ovrFalse;
+		for (int i = 0; i < count; i++) {
+			if (!OVR_SUCCESS(ovr_CreateTextureSwapChainGL(session, &desc, &chains[i]))) {
+				FAIL("Failed to create quad layer swap textures");
+			}
+			memset(&layers[i], 0, sizeof(ovrLayerQuad));
+			layers[i].Header.Type = ovrLayerType_Quad;
+			layers[i].Header.Flags = ovrLayerFlag_TextureOriginAtBottomLeft | ovrLayerFlag_HighQuality;
+			layers[i].ColorTexture = chains[i];
+		}
+	}
+
+	~RiftQuadLayers() {
+		for (ovrTextureSwapChain chain : chains) {
+			ovr_DestroyTextureSwapChain(session, chain);
+		}
+	}
+
+	GLuint texture(int quad) override {
+		int index;
+		ovr_GetTextureSwapChainCurrentIndex(session, chains[quad], &index);
+		GLuint texId;
+		ovr_GetTextureSwapChainBufferGL(session, chains[quad], index, &texId);
+		return texId;
+	}
+
+	void commit(int quad, const Placement & placement) override {
+		ovr_CommitTextureSwapChain(session, chains[quad]);
+		ovrLayerQuad & layer = layers[quad];
+		layer.Viewport.Pos = { 0, 0 };
+		layer.Viewport.Size = ovr::fromGlm(uvec2(placement.extent));
+		layer.QuadPoseCenter.Orientation = ovr::fromGlm(glm::quat_cast(mat3(placement.pose)));
+		layer.QuadPoseCenter.Position = ovr::fromGlm(vec3(placement.pose[3]));
+		layer.QuadSize = ovr::fromGlm(placement.size);
+		committed[quad] = true;
+	}
+
+	// Quads with an image, in wall order
+	void headers(std::vector<const ovrLayerHeader*> & list) const {
+		for (int i = 0; i < quadCount; i++) {
+			if (committed[i]) {
+				list.push_back(&layers[i].Header);
+			}
+		}
+	}
+};
+
 class Cursor {
 
-	// Shader ID
-	GLuint shaderID;
+	// Shader ID, per eye and several views at once
+	GLuint shaderID, stereoShaderID;
 
 	// Cursor
 	std::unique_ptr<Model> cursor;
 
+	// Bounding radius of the model at its drawn scale
+	float radius;
+
 public:
 
 	// User's Dominant Hand's Controller Position 
 	glm::vec3 position;
 
-	Cursor() {
+	// viewDefines sets the view count of the stereo program, see EyeBufferConfig::viewDefines
+	explicit Cursor(const std::string & viewDefines) {
 		shaderID = LoadShaders("cursor.vert", "cursor.frag");
+		ViewBlock::attach(shaderID);
+		stereoShaderID = LoadShaders("cursor_stereo.vert", "cursor_stereo.geom", "cursor.frag", viewDefines.c_str());
 		cursor = std::make_unique<Model>("webtrcc.obj");
+
+		radius = 0.0f;
+		for (const Mesh & mesh : cursor->meshes) {
+			for (const Vertex & vertex : mesh.vertices) {
+				radius = std::max(radius, glm::length(vertex.Position) * 0.01f);
+			}
+		}
+	}
+
+	GLuint program() const { return shaderID; }
+	GLuint stereoProgram() const { return stereoShaderID; }
+
+	// Bounding sphere as (center, radius)
+	glm::vec4 bounds() const {
+		return glm::vec4(position, radius);
+	}
+
+	/* Render sphere at User's Dominant Hand's Controller Position, seen from the bound PerView slot */
+	void render() {
+		glm::mat4 toWorld = glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), glm::vec3(0.01f));
+		cursor->Draw(shaderID, glm::mat4(1.0f), glm::mat4(1.0f), toWorld);
 	}
 
-	/* Render sphere at User's Dominant Hand's Controller Position */
-	void render(const glm::mat4& projection, const glm::mat4& view) {
+	// Every view at once, view i to viewport i
+	void renderViews(const ViewSet & views) {
 		glm::mat4 toWorld = glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), glm::vec3(0.01f));
-		cursor->Draw(shaderID, projection, view, toWorld);
+		GLState::useProgram(stereoShaderID);
+		views.upload(stereoShaderID);
+		cursor->Draw(stereoShaderID, glm::mat4(1.0f), glm::mat4(1.0f), toWorld);
 	}
 
 };
@@ -674,7 +983,6 @@ class Scene {
 	std::unique_ptr<Cave> cave;
 	
 	// Skybox
-	Skybox * skybox; // current skybox
 	Skybox * lefteye_skybox; // skybox for left eye
 	Skybox * righteye_skybox; // skybox for right eye
 	std::unique_ptr<Skybox> self_skybox; // customized skybox
@@ -689,6 +997,18 @@ class Scene {
 	
 	// ShaderID
 	GLint shaderID, skyboxShaderID, lineShaderID;
+	// Stereo and multi-resolution mode draw every view at once through viewSetPass, unset otherwise
+	std::unique_ptr<ViewSetPass> viewSetPass;
+	// Draws of the eye pass, sorted before they run
+	RenderQueue queue;
+
+	// Per frame data of the lines and the view block, declared first so it outlives the view block
+	std::unique_ptr<StreamBuffer> stream;
+	enum { STREAM_BYTES_PER_FRAME = 64 * 1024 };
+	// Camera data of every view in the frame: the eye pass of each eye, then per eye the wall pass and the inset pass
+	enum { VIEW_EYES = 0, VIEW_WALL_PASSES = 2, VIEW_SLOTS = 6 };
+	std::unique_ptr<ViewBlock> viewBlock;
+	static_assert(ViewBlock::MAX_WALLS == Cave::MAX_WALLS, "PerView holds a projection per cave wall");
 	
 public:
 
@@ -702,7 +1022,6 @@ public:
 	// Cube
 	std::unique_ptr<TexturedCube> cube;
 	std::vector<glm::mat4> instance_positions;
-	GLuint instanceCount;
 	// Cube Size and Position
 	float cubeSize;
 	glm::vec3 cubePos;
@@ -710,16 +1029,37 @@ public:
 	// Currenr Eye Index : 0 for LEFT eye, 1 for RIGHT eye
 	int curEyeIdx;
 
-	// Frame Buffers
-	GLuint lFBO, lrenderedTexture, lRBO; // LEFT
-	GLuint rFBO, rrenderedTexture, rRBO; // RIGHT
-	GLuint bFBO, brenderedTexture, bRBO; // BUTTOM
+	// Near and far plane of the wall projections
+	float nearPlane, farPlane;
+	// Off-axis projection of each wall, computed once per eye and frame and shared by all wall draws
+	glm::mat4 eyeWallProjections[2][Cave::MAX_WALLS];
+
+	// What the walls show, handed to the wall passes
+	WallContent content;
+	// Portal mode draws the walls through portalPass, quad mode shows them as quad layers
+	// through quadPass, otherwise wallPass renders wall images. Only one of them is set.
+	std::unique_ptr<PortalPass> portalPass;
+	std::unique_ptr<QuadWallPass> quadPass;
+	std::unique_ptr<WallPass> wallPass;
 
 	// EXTRA CREDIT 1
 	int randNum;
 	bool randNumGenerated;
 
-	Scene() {
+	WallStats frameStats; // frame in progress
+	// Completed frames are summed and logged as per frame averages every STATS_FRAMES frames
+	enum { STATS_FRAMES = 450 };
+	WallStats statsSum;
+	int statsFrames = 0;
+	// DynamicResolution::changes at the last recordResolution
+	unsigned int knownScaleChanges = 0;
+	GLState::Counts stateCountsSum; // GL state calls issued and elided, summed like statsSum
+
+	// Union of both HMD eye frusta for the current frame
+	Frustum hmdFrustum;
+
+	// eyeBuffer is resolved against the walls' mode, the stereo programs are built for its view count
+	explicit Scene(EyeBufferConfig & eyeBuffer) {
 
 		srand(time(0));
 
@@ -737,88 +1077,50 @@ public:
 		// 0 for Normal mode and 1 for disabling a random projector
 		buttonX = 0;
 
-		// EXTRA CREDIT 1
-		randNum = rand() % 6;
+		// Cave
+		nearPlane = 0.01f;
+		farPlane = 1000.0f;
+		cave = std::make_unique<Cave>();
+		cave->toWorld = glm::rotate(glm::mat4(1.0f), -glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		cave->updateWalls();
+		eyeBuffer.resolve(cave->portal || cave->quads == Cave::QUADS_EYE_BUFFER);
+		std::string views = eyeBuffer.viewDefines();
+
+		// EXTRA CREDIT 1, one projector per wall and eye
+		randNum = rand() % (2 * cave->wallCount());
 		randNumGenerated = false;
 
 		// Cursors
-		LeftEyeCursor = std::unique_ptr<Cursor>(new Cursor());
-		RightEyeCursor = std::unique_ptr<Cursor>(new Cursor());
+		LeftEyeCursor = std::unique_ptr<Cursor>(new Cursor(views));
+		RightEyeCursor = std::unique_ptr<Cursor>(new Cursor(views));
 		
 
 		// ShaderID
 		shaderID = LoadShaders("shader.vert", "shader.frag");
 		skyboxShaderID = LoadShaders("skybox.vert", "skybox.frag");
 		lineShaderID = LoadShaders("line.vert", "line.frag");
-
-		// LEFT Texture Mapping
-
-		// Frame buffer
-		glGenFramebuffers(1, &lFBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, lFBO);
-		// Bind texture to render
-		glGenTextures(1, &lrenderedTexture); 
-		glBindTexture(GL_TEXTURE_2D, lrenderedTexture);
-		// Give an empty image to OpenGL
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2048, 2048, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-		// Poor filtering
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		// Set renderedTexture as color attachment
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lrenderedTexture, 0);
-		// Depth buffer
-		glGenRenderbuffers(1, &lRBO);
-		glBindRenderbuffer(GL_RENDERBUFFER, lRBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 2048, 2048);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, // 1. fbo target: GL_FRAMEBUFFER
-			GL_DEPTH_ATTACHMENT, // 2. attachment point
-			GL_RENDERBUFFER, // 3. rbo target: GL_RENDERBUFFER
-			lRBO); // 4. rbo ID
-
-		// RIGHT Texture Mapping
-		glGenFramebuffers(1, &rFBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, rFBO);
-
-		glGenTextures(1, &rrenderedTexture);
-		glBindTexture(GL_TEXTURE_2D, rrenderedTexture);
-
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2048, 2048, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rrenderedTexture, 0);
-
-		glGenRenderbuffers(1, &rRBO);
-		glBindRenderbuffer(GL_RENDERBUFFER, rRBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 2048, 2048);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rRBO); 
-
-		// BOTTOM Texture Mapping
-		glGenFramebuffers(1, &bFBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, bFBO);
-
-		glGenTextures(1, &brenderedTexture);
-		glBindTexture(GL_TEXTURE_2D, brenderedTexture);
-
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2048, 2048, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brenderedTexture, 0);
-
-		glGenRenderbuffers(1, &bRBO);
-		glBindRenderbuffer(GL_RENDERBUFFER, bRBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 2048, 2048);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, bRBO); 
-
-		// Cave
-		cave = std::make_unique<Cave>();
-		cave->toWorld = glm::rotate(glm::mat4(1.0f), -glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		for (GLuint program : { shaderID, skyboxShaderID, lineShaderID }) {
+			ViewBlock::attach(program);
+		}
+		// Stereo and multi-resolution mode, a geometry shader sends each draw to several viewports
+		if (eyeBuffer.stereo || eyeBuffer.multiRes()) {
+			viewSetPass = std::make_unique<ViewSetPass>(views);
+		}
+		stream = std::make_unique<StreamBuffer>(STREAM_BYTES_PER_FRAME);
+		std::cout << "stream buffer: " << StreamBuffer::FRAMES << " x " << STREAM_BYTES_PER_FRAME / 1024 << " KiB, "
+			<< (stream->persistent() ? "persistently mapped" : "glBufferSubData") << std::endl;
+		viewBlock = std::make_unique<ViewBlock>(*stream, VIEW_SLOTS);
+
+		// Portal mode renders no wall images, quad mode one set for both eyes
+		if (cave->portal) {
+			portalPass = std::make_unique<PortalPass>(*cave, frameStats);
+		}
+		else if (cave->quads != Cave::QUADS_OFF) {
+			quadPass = std::make_unique<QuadWallPass>(*cave, *viewBlock, VIEW_WALL_PASSES, frameStats, nearPlane, farPlane);
+		}
+		else {
+			wallPass = std::make_unique<WallPass>(*cave, *viewBlock, VIEW_WALL_PASSES, frameStats, false, nearPlane, farPlane);
+		}
 
 		// Skybox
 		// Skybox for right eye
@@ -834,207 +1136,289 @@ public:
 		// Cube
 		instance_positions.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0, 0.0, -0.3f)));
 		instance_positions.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0, 0.0, -0.9f)));
-		instanceCount = instance_positions.size();
 
 		cube = std::make_unique<TexturedCube>("cube");
 		cubeSize = 0.1f; //20 cm
 		
 		cube->toWorld = glm::translate(glm::mat4(1.0f), cubePos) * glm::scale(glm::mat4(1.0f), glm::vec3(cubeSize));
-		
 
-		// Lines
-		for (unsigned int i = 0; i < 7; i++) {
-			LLines.push_back(new Line());
-			RLines.push_back(new Line());
+		// The walls show the cubes and each eye's skybox, cubeSize is picked up every pass
+		content.cube = cube.get();
+		content.instances = &instance_positions;
+		content.skyboxes[0] = lefteye_skybox;
+		content.skyboxes[1] = righteye_skybox;
+
+		// Lines, one from each eye to every cave corner
+		for (size_t i = 0; i < cave->getCorners().size(); i++) {
+			LLines.push_back(new Line(*stream));
+			RLines.push_back(new Line(*stream));
 		}
 	}
 
 	
 
-	void preRender(const glm::mat4 & projection, const glm::mat4 & modelview, GLuint _fbo, const ovrRecti & vp, const glm::vec3 & eyePos) {
+	// Call once per frame before the first eye with the combined stereo frustum
+	void beginFrame(const Frustum & stereoFrustum) {
+		statsSum += frameStats;
+		GLState::Counts stateCounts = GLState::takeCounts();
+		stateCountsSum.issued += stateCounts.issued;
+		stateCountsSum.elided += stateCounts.elided;
+		if (++statsFrames == STATS_FRAMES) {
+			logStats();
+			statsSum = WallStats();
+			stateCountsSum = GLState::Counts();
+			statsFrames = 0;
+		}
+		frameStats = WallStats();
+		hmdFrustum = stereoFrustum;
+		stream->beginFrame();
+	}
 
-		// Extra Credit
-		if (buttonX == 1 && randNumGenerated == false) {
-			randNum = rand() % 6;
-			randNumGenerated = true;
-			//std::cout << randNum << std::endl; // Testing
+	// Per frame averages of the summed stats
+	void logStats() const {
+		float frames = (float)statsFrames;
+		std::cout << "walls per frame: " << statsSum.wallsRendered / frames << " rendered, " << statsSum.wallsCached / frames << " cached, "
+			<< statsSum.wallsCulled / frames << " culled, " << statsSum.wallsReprojected / frames << " reprojected, "
+			<< statsSum.insetsRendered / frames << " insets; cubes per frame: " << statsSum.instancesDrawn / frames << " drawn, "
+			<< statsSum.instancesCulled / frames << " culled" << std::endl;
+		std::cout << "GL state calls per frame: " << stateCountsSum.issued / frames << " issued, "
+			<< stateCountsSum.elided / frames << " elided as redundant" << std::endl;
+		if (statsSum.eyeScale > 0.0f) {
+			std::cout << "eye buffer: scale " << statsSum.eyeScale / frames << " at " << statsSum.gpuMilliseconds / frames
+				<< " ms GPU per frame, " << statsSum.scaleChanges << " scale changes" << std::endl;
 		}
+	}
 
-		float nearPlane = 0.01f, farPlane = 1000.0f;
+	// Dynamic resolution state of the frame in progress
+	void recordResolution(const DynamicResolution & resolution) {
+		frameStats.eyeScale = resolution.scale();
+		frameStats.gpuMilliseconds = resolution.gpuMilliseconds();
+		frameStats.scaleChanges = resolution.changes - knownScaleChanges;
+		knownScaleChanges = resolution.changes;
+	}
 
+	// Call once per frame after the last eye pass
+	void endFrame() {
+		stream->endFrame();
+	}
 
-		// Render scene to texture LEFT
-		glBindFramebuffer(GL_FRAMEBUFFER, lFBO);
-		glViewport(0, 0, 2048, 2048);
-		glClearColor(0.f, 0.f, 0.f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	void preRender(const glm::mat4 & projection, const glm::mat4 & modelview, const glm::mat4 & hmdView, GLuint _fbo, const ovrRecti & vp, const glm::vec3 & eyePos) {
 
-		vec3 pa = glm::vec3(cave->toWorld * vec4(-2.0f, -2.0f, 2.0f, 1.0f));
-		vec3 pb = glm::vec3(cave->toWorld * vec4(-2.0f, -2.0f, -2.0f, 1.0f));
-		vec3 pc = glm::vec3(cave->toWorld * vec4(-2.0f, 2.0f, 2.0f, 1.0f));
-
-		if (buttonX == 0 || curEyeIdx * 3 != randNum) {
-			glUseProgram(skyboxShaderID);
-			skybox->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
-			//cube->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
-			for (unsigned int i = 0; i < instanceCount; i++) {
-				cube->toWorld =  instance_positions[i] * glm::scale(glm::mat4(1.0f), glm::vec3(cubeSize));
-				cube->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
-			}
+		// Extra Credit
+		if (buttonX == 1 && randNumGenerated == false) {
+			randNum = rand() % (2 * cave->wallCount());
+			randNumGenerated = true;
+			//std::cout << randNum << std::endl; // Testing
 		}
-		
-		
-		// Update Lines
-		if (curEyeIdx == 0) {
 
-			LLines[0]->update(pc, eyePos, false);
-			LLines[1]->update(pa, eyePos, false); 
-			LeftEyeCursor->position = eyePos;
+		// Wall corners and bases only change when the cave moves
+		cave->updateWalls();
+		content.cubeSize = cubeSize;
+		const std::vector<Cave::Wall> & caveWalls = cave->getWalls();
+
+		// Per-wall projections, resolutions, HMD visibility and the projector mask,
+		// wall i of this eye is projector curEyeIdx * wallCount + i
+		int wallCount = cave->wallCount();
+		glm::mat4 hmdViewProjection = projection * hmdView;
+		glm::mat4 * wallProjections = eyeWallProjections[curEyeIdx];
+		std::vector<glm::ivec2> extent;
+		if (quadPass) {
+			extent = quadPass->extent();
 		}
-		else {
-			
-			RLines[0]->update(pc, eyePos, true);
-			RLines[1]->update(pa, eyePos, true);
-			RightEyeCursor->position = eyePos;
+		else if (wallPass) {
+			extent = wallPass->current(curEyeIdx).extent;
 		}
-
-		// Render scene to texture RIGHT
-		glBindFramebuffer(GL_FRAMEBUFFER, rFBO);
-		glViewport(0, 0, 2048, 2048);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		pa = glm::vec3(cave->toWorld * vec4(-2.0f, -2.0f, -2.0f, 1.0f));
-		pb = glm::vec3(cave->toWorld * vec4(2.0f, -2.0f, -2.0f, 1.0f));
-		pc = glm::vec3(cave->toWorld * vec4(-2.0f, 2.0f, -2.0f, 1.0f));
-
-		if (buttonX == 0 || curEyeIdx * 3 + 1 != randNum) {
-			glUseProgram(skyboxShaderID);
-			skybox->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
-			//cube->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
-			for (unsigned int i = 0; i < instanceCount; i++) {
-				cube->toWorld = instance_positions[i] * glm::scale(glm::mat4(1.0f), glm::vec3(cubeSize));
-				cube->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
+		// Walls are only shaded where this eye sees them. Reprojected and quad walls are
+		// sampled from other views, they keep the whole wall.
+		bool scissor = wallPass && cave->wallsPerPass == 0;
+		std::vector<glm::vec4> visible(extent.size(), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+		Frustum eyeFrustum(hmdViewProjection);
+		int wallMask = 0, visibleMask = 0;
+		for (int i = 0; i < wallCount; i++) {
+			const Cave::Wall & wall = caveWalls[i];
+			wallProjections[i] = WallView::projection(eyePos, wall, nearPlane, farPlane);
+			bool seen = WallView::visible(hmdViewProjection, wall);
+			// Clipping the wall also rejects the walls the corner test lets through
+			if (seen && scissor) {
+				visible[i] = WallView::visibleRect(eyeFrustum, wall);
+				seen = visible[i].z > visible[i].x && visible[i].w > visible[i].y;
+			}
+			if (seen) {
+				visibleMask |= 1 << i;
+				if (!portalPass) {
+					extent[i] = WallView::resolution(hmdViewProjection, ivec2(vp.Size.w, vp.Size.h), wall);
+				}
+			}
+			else {
+				frameStats.wallsCulled++;
+				if (scissor) {
+					visible[i] = glm::vec4(0.0f);
+				}
+			}
+			if (buttonX == 0 || curEyeIdx * wallCount + i != randNum) {
+				wallMask |= 1 << i;
 			}
 		}
 
-		
-		// Update Lines
-		if (curEyeIdx == 0) {
-
-			LLines[2]->update(pc, eyePos, false);
-			LLines[3]->update(pa, eyePos, false);
-			LLines[4]->update(pb + (pc - pa), eyePos, false);
-			LLines[5]->update(pb, eyePos, false);
+		// Portal mode draws the walls straight into the eye buffer in render
+		if (portalPass) {
+			portalPass->prepare(curEyeIdx, modelview, visibleMask, wallMask);
+		}
+		else if (quadPass) {
+			quadPass->render(curEyeIdx, modelview, hmdView, eyePos, wallMask, visibleMask, extent, content);
 		}
 		else {
-
-
-			RLines[2]->update(pc, eyePos, true);
-			RLines[3]->update(pa, eyePos, true);
-			RLines[4]->update(pb + (pc - pa), eyePos, true);
-			RLines[5]->update(pb, eyePos, true);
+			wallPass->render(curEyeIdx, modelview, hmdView, eyePos, wallProjections, wallMask, visibleMask, extent, visible, content);
 		}
 
-		// Render scene to texture BOTTOM
-		glBindFramebuffer(GL_FRAMEBUFFER, bFBO);
-		glViewport(0, 0, 2048, 2048);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		pa = glm::vec3(cave->toWorld * vec4(-2.0f, -2.0f, 2.0f, 1.0f));
-		pb = glm::vec3(cave->toWorld * vec4(2.0f, -2.0f, 2.0f, 1.0f));
-		pc = glm::vec3(cave->toWorld * vec4(-2.0f, -2.0f, -2.0f, 1.0f));
-
-		if (buttonX == 0 || (curEyeIdx * 3 + 2) != randNum) {
-			glUseProgram(skyboxShaderID);
-			skybox->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
-			//cube->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
-			for (unsigned int i = 0; i < instanceCount; i++) {
-				cube->toWorld = instance_positions[i] * glm::scale(glm::mat4(1.0f), glm::vec3(cubeSize));
-				cube->draw(skyboxShaderID, getProjection(eyePos, pa, pb, pc, nearPlane, farPlane), modelview);
-			}
+		// Update Lines
+		const std::vector<glm::vec3> & corners = cave->getCorners();
+		std::vector<Line*> & lines = curEyeIdx == 0 ? LLines : RLines;
+		for (size_t i = 0; i < corners.size() && i < lines.size(); i++) {
+			lines[i]->update(corners[i], eyePos, curEyeIdx != 0);
 		}
-		
-
-		// Update Line
 		if (curEyeIdx == 0) {
-			
-			LLines[6]->update(pb, eyePos, false);
+			LeftEyeCursor->position = eyePos;
 		}
 		else {
-			
-			RLines[6]->update(pb, eyePos, true);
+			RightEyeCursor->position = eyePos;
 		}
 
 		// Restore FBO
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		GLState::clearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
-		glViewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
+		GLState::viewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
 	}
 
-	glm::mat4 getProjection(glm::vec3 eyePos, glm::vec3 pa, glm::vec3 pb, glm::vec3 pc, float n, float f) {
+	void render(const mat4 & projection, const mat4 & modelview, const glm::vec3 & eyePos) {
+
+		// The eye pass programs read the eye from PerView, the draws below only set their own transforms
+		ViewBlock::Data view = {};
+		view.eyeProjection = projection;
+		view.eyeView = modelview;
+		view.eyePosition = vec4(eyePos, 1.0f);
+		viewBlock->write(VIEW_EYES + curEyeIdx, view);
 
-		vec3 vr = glm::normalize(pb - pa);
-		vec3 vu = glm::normalize(pc - pa);
-		vec3 vn = glm::normalize(glm::cross(vr, vu));
-		vec3 va = pa - eyePos;
-		vec3 vb = pb - eyePos;
-		vec3 vc = pc - eyePos;
+		// Cave
+		float caveDepth = glm::distance(eyePos, caveCenter());
+		if (portalPass) {
+			portalPass->submit(queue, curEyeIdx, projection, modelview, eyeWallProjections[curEyeIdx], content);
+		}
+		else if (quadPass) {
+			quadPass->submit(queue, shaderID, caveDepth);
+		}
+		else {
+			wallPass->submit(queue, shaderID, curEyeIdx, caveDepth);
+		}
+		
+		// Render Lines, they start at the eye
+		if (buttonAPressed == true) {
+			queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, lineShaderID, 0, 0.0f), [this] {
+				GLState::useProgram(lineShaderID);
+				for (size_t i = 0; i < LLines.size(); i++) {
+					LLines[i]->draw(lineShaderID);
+					RLines[i]->draw(lineShaderID);
+				}
+			});
 
-		float d = -glm::dot(vn, va);
-		float l = glm::dot(vr, va) * n / d;
-		float r = glm::dot(vr, vb) * n / d;
-		float b = glm::dot(vu, va) * n / d;
-		float t = glm::dot(vu, vc) * n / d;
+			// Cursor
+			submitCursor(*LeftEyeCursor, eyePos);
+			submitCursor(*RightEyeCursor, eyePos);
+		}
 
-		glm::mat4 P = glm::frustum(l, r, b, t, n, f);
+		// Customized Skybox, last so the depth test leaves it only the pixels nothing else covered
+		queue.submit(RenderQueue::key(RenderQueue::PASS_SKY, skyboxShaderID, self_skybox->cubeMap, 0.0f), [this] {
+			self_skybox->draw(skyboxShaderID, mat4(1.0f));
+		});
+	}
 
-		glm::mat4 M = glm::mat4(vr.x, vr.y, vr.z, 0.0f,
-								vu.x, vu.y, vu.z, 0.0f, 
-								vn.x, vn.y, vn.z, 0.0f, 
-								0.0f, 0.0f, 0.0f, 1.0f);
+	// Queue a cursor of the eye pass if the HMD sees it
+	void submitCursor(Cursor & cursor, const glm::vec3 & eyePos) {
+		if (hmdFrustum.intersects(cursor.bounds())) {
+			Cursor * target = &cursor;
+			queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, cursor.program(), 0, glm::distance(eyePos, cursor.position)),
+				[target] { target->render(); });
+		}
+	}
 
-		glm::mat4 T = glm::translate(glm::vec3(-eyePos.x, -eyePos.y, -eyePos.z));
+	// Draw everything render or renderViews queued, call once per eye pass or view set
+	void executeQueue() {
+		queue.execute();
+	}
 
-		return P * glm::transpose(M) * T;
+	// Middle of the cave in world space, the distance the walls are sorted by
+	vec3 caveCenter() const {
+		const std::vector<glm::vec3> & corners = cave->getCorners();
+		vec3 center(0.0f);
+		for (const glm::vec3 & corner : corners) {
+			center += corner;
+		}
+		return corners.empty() ? center : center / (float)corners.size();
 	}
 
-	void render(const mat4 & projection, const mat4 & modelview, const glm::vec3 & eyePos) {
+	// Stereo and multi-resolution mode: queue every view at once, view i to viewport i, after both eyes' preRender.
+	// views must live until executeQueue.
+	void renderViews(const ViewSet & views) {
+
+		// Distances are taken from the first view's eye
+		vec3 eyePos = vec3(glm::inverse(views.view[0])[3]);
 
-		// Customized Skybox
-		glUseProgram(skyboxShaderID);
-		self_skybox->draw(skyboxShaderID, projection, modelview);
 		// Cave
-		glUseProgram(shaderID);
-		cave->draw(shaderID, projection, modelview, lrenderedTexture, rrenderedTexture, brenderedTexture);
-		
-		// Render Lines
+		float caveDepth = glm::distance(eyePos, caveCenter());
+		if (quadPass) {
+			quadPass->submitViews(queue, viewSetPass->caveProgram(), views, caveDepth);
+		}
+		else {
+			wallPass->submitViews(queue, viewSetPass->caveProgram(), views, caveDepth);
+		}
+
+		// Render Lines, they start at the eye
 		if (buttonAPressed == true) {
-			glUseProgram(lineShaderID);
-		
-			for (unsigned i = 0; i < 7; i++) {
-				LLines[i]->draw(lineShaderID, projection, modelview);
-				RLines[i]->draw(lineShaderID, projection, modelview);
-			}
+			viewSetPass->submitLines(queue, views, LLines, RLines);
 
 			// Cursor
-			LeftEyeCursor->render(projection, modelview);
-			RightEyeCursor->render(projection, modelview);
+			submitCursorViews(*LeftEyeCursor, views);
+			submitCursorViews(*RightEyeCursor, views);
 		}
 
-		
+		// Customized Skybox, last so the depth test leaves it only the pixels nothing else covered
+		viewSetPass->submitSkybox(queue, views, *self_skybox);
 	}
 
-	void currentEye(int eyeIdx) {
-		curEyeIdx = eyeIdx;
-		if (eyeIdx == 0) {
-			skybox = lefteye_skybox;
+	// Queue a cursor of a view set pass if the HMD sees it, views must live until executeQueue
+	void submitCursorViews(Cursor & cursor, const ViewSet & views) {
+		if (hmdFrustum.intersects(cursor.bounds())) {
+			Cursor * target = &cursor;
+			vec3 eyePos = vec3(glm::inverse(views.view[0])[3]);
+			queue.submit(RenderQueue::key(RenderQueue::PASS_OPAQUE, cursor.stereoProgram(), 0, glm::distance(eyePos, cursor.position)),
+				[target, &views] { target->renderViews(views); });
 		}
-		else {
-			skybox = righteye_skybox;
+	}
+
+	Cave::QuadMode quadMode() const { return cave->quads; }
+	int wallCount() const { return cave->wallCount(); }
+	// Size of the wall images, 0 without any
+	GLsizei wallImageSize() const {
+		return quadPass ? quadPass->imageSize() : wallPass ? wallPass->current(0).size : 0;
+	}
+	// SDK quad mode: the layers the walls are shown with, made by the app for its session
+	void setQuadLayers(std::unique_ptr<QuadLayers> layers) {
+		if (quadPass) {
+			quadPass->setLayers(std::move(layers));
 		}
-		
+	}
+
+	// Eye buffer quad mode composites the quads itself once the eye buffer is complete
+	void compositeQuads(const glm::mat4 & viewProjection) {
+		if (quadPass) {
+			quadPass->composite(viewProjection);
+		}
+	}
+
+	void currentEye(int eyeIdx) {
+		curEyeIdx = eyeIdx;
 	}
 
 };
@@ -1044,6 +1428,8 @@ public:
 class ExampleApp : public RiftApp {
 
 	std::shared_ptr<Scene> scene;
+	// Owned by the scene, kept for submission
+	RiftQuadLayers * riftQuads{ nullptr };
 
 public:
 	ExampleApp() {}
@@ -1069,24 +1455,33 @@ protected:
 		RiftApp::initGl();
 
 		// Enable depth buffering
-		glEnable(GL_DEPTH_TEST);
+		GLState::enable(GL_DEPTH_TEST);
 		// Related to shaders and z value comparisons for the depth buffer
-		glDepthFunc(GL_LEQUAL);
+		GLState::depthFunc(GL_LEQUAL);
 		// Set polygon drawing mode to fill front and back of each polygon
 		// You can also use the paramter of GL_LINE instead of GL_FILL to see wireframes
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		GLState::polygonMode(GL_FILL);
 		// Disable backface culling to render both sides of polygons
-		glDisable(GL_CULL_FACE);
+		GLState::disable(GL_CULL_FACE);
 		// Set clear color
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		GLState::clearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
 		ovr_RecenterTrackingOrigin(_session);
 
-		// Scene
-		scene = std::shared_ptr<Scene>(new Scene());
+		// Scene, it shares the config file with the eye buffer options
+		EyeBufferConfig eyeBuffer;
+		eyeBuffer.load("cave.cfg");
+		scene = std::shared_ptr<Scene>(new Scene(eyeBuffer));
+		// SDK quad layers need the session
+		if (scene->quadMode() == Cave::QUADS_SDK) {
+			riftQuads = new RiftQuadLayers(_session, scene->wallCount(), scene->wallImageSize());
+			scene->setQuadLayers(std::unique_ptr<QuadLayers>(riftQuads));
+		}
+
+		configureEyeBuffer(eyeBuffer);
 
 		// Cursor
-		cursor = std::unique_ptr<Cursor>(new Cursor());
+		cursor = std::unique_ptr<Cursor>(new Cursor(eyeBuffer.viewDefines()));
 	}
 
 	void shutdownGl() override {}
@@ -1188,7 +1583,7 @@ protected:
 	}
 
 	// Off-Screen Rendering
-	void offscreenRender(const glm::mat4 & projection, const glm::mat4 & headPose, GLuint _fbo, const ovrRecti & vp, const glm::vec3 & eyePos) {
+	void offscreenRender(const glm::mat4 & projection, const glm::mat4 & headPose, const glm::mat4 & hmdPose, GLuint _fbo, const ovrRecti & vp, const glm::vec3 & eyePos) {
 
 		// Head-in-Hand Mode
 		if (scene->RHTriggerPressed) { // Switch to Right Hand Controller Position
@@ -1212,10 +1607,10 @@ protected:
 
 			adjustedEyePose.x += getDefaultIOD(scene->curEyeIdx); // ADD Default IOD
 
-			scene->preRender(projection, glm::inverse(no_rotation), _fbo, vp, adjustedEyePose);
+			scene->preRender(projection, glm::inverse(no_rotation), glm::inverse(hmdPose), _fbo, vp, adjustedEyePose);
 		}
 		else { // Switch Back to Head Position
-			scene->preRender(projection, glm::inverse(headPose), _fbo, vp, eyePos);
+			scene->preRender(projection, glm::inverse(headPose), glm::inverse(hmdPose), _fbo, vp, eyePos);
 		}
 	}
 
@@ -1226,7 +1621,28 @@ protected:
 		// Render Scene
 		scene->render(projection, glm::inverse(headPose), eyePos);
 		// Update Cursor
-		cursor->render(projection, glm::inverse(headPose));
+		scene->submitCursor(*cursor, eyePos);
+		scene->executeQueue();
+		scene->compositeQuads(projection * glm::inverse(headPose));
+	}
+
+	void renderSceneViews(const ViewSet & views) override {
+
+		scene->renderViews(views);
+		// Update Cursor
+		scene->submitCursorViews(*cursor, views);
+		scene->executeQueue();
+	}
+
+	void beginFrame(const glm::mat4 eyeViewProjections[2]) override {
+		scene->beginFrame(Frustum::stereo(Frustum(eyeViewProjections[ovrEye_Left]), Frustum(eyeViewProjections[ovrEye_Right])));
+		if (dynamicResolution()) {
+			scene->recordResolution(*dynamicResolution());
+		}
+	}
+
+	void endFrame() override {
+		scene->endFrame();
 	}
 
 	void currentEye(ovrEyeType eye) {
@@ -1240,6 +1656,12 @@ protected:
 
 	int FreezeMode() { return scene->buttonB; }
 
+	void underlayLayers(std::vector<const ovrLayerHeader*> & layers) override {
+		if (riftQuads) {
+			riftQuads->headers(layers);
+		}
+	}
+
 
 };
 
@@ -0,0 +1,35 @@
+#version 330 core
+// Multi-resolution eye pass composite: finds the region an eye pixel falls in
+// and samples it where that region's viewport put the pixel in the packed image.
+// Per region arrays hold the low, center and high region, x and y components
+// the two axes.
+
+// Eye viewport in the eye buffer
+uniform vec2 eyeOrigin;
+uniform vec2 eyeSize;
+// NDC boundaries between the low and center, and the center and high regions
+uniform vec2 split[2];
+// Viewport each region was drawn with, in packed image pixels
+uniform vec2 viewportOrigin[3];
+uniform vec2 viewportSize[3];
+// Pixels of the packed image each region covers
+uniform vec2 regionMin[3];
+uniform vec2 regionMax[3];
+
+uniform sampler2D image;
+uniform vec2 imageSize;
+
+out vec4 fragColor;
+
+void main()
+{
+    vec2 ndc = (gl_FragCoord.xy - eyeOrigin) / eyeSize * 2.0 - 1.0;
+    ivec2 region = ivec2(step(split[0], ndc) + step(split[1], ndc));
+    vec2 origin = vec2(viewportOrigin[region.x].x, viewportOrigin[region.y].y);
+    vec2 size = vec2(viewportSize[region.x].x, viewportSize[region.y].y);
+    // Half a texel inside the region, filtering never reads a neighbouring one
+    vec2 lower = vec2(regionMin[region.x].x, regionMin[region.y].y) + 0.5;
+    vec2 upper = vec2(regionMax[region.x].x, regionMax[region.y].y) - 0.5;
+    vec2 texel = clamp(origin + (ndc * 0.5 + 0.5) * size, lower, upper);
+    fragColor = texture(image, texel / imageSize);
+}
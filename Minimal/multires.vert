@@ -0,0 +1,9 @@
+#version 330 core
+// Multi-resolution eye pass composite: one triangle covering the eye viewport,
+// the corners come from gl_VertexID so no vertex buffer is needed.
+
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
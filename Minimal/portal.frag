@@ -0,0 +1,18 @@
+#version 410 core
+// Shades the scene seen through a CAVE wall in portal mode
+
+in vec3 TexCoords;
+in vec2 WallDepth;
+
+uniform samplerCube skybox;
+// 0 while the wall's projector is off, the wall stays black
+uniform int lit;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = lit != 0 ? texture(skybox, TexCoords) : vec4(0.0, 0.0, 0.0, 1.0);
+    // Depth as the wall pass would store it, every fragment of the portal lies on the wall plane otherwise
+    gl_FragDepth = WallDepth.x / WallDepth.y * 0.5 + 0.5;
+}
@@ -0,0 +1,31 @@
+#version 410 core
+// CAVE portal mode: draws the scene straight into a wall's part of the eye
+// buffer. The wall's off-axis projection gives wall clip space, portalMatrix
+// maps the wall's clip square onto the wall quad as the HMD eye sees it.
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+
+out vec3 TexCoords;
+out vec2 WallDepth;
+
+uniform mat4 view;
+uniform mat4 wallProjection;
+uniform mat4 portalMatrix;
+
+void main()
+{
+    TexCoords = position;
+    vec4 wallClip = wallProjection * view * vec4(position, 1.0);
+
+    // Clip to the wall frustum, geometry outside it must not leak past the wall edges
+    gl_ClipDistance[0] = wallClip.w + wallClip.x;
+    gl_ClipDistance[1] = wallClip.w - wallClip.x;
+    gl_ClipDistance[2] = wallClip.w + wallClip.y;
+    gl_ClipDistance[3] = wallClip.w - wallClip.y;
+    gl_ClipDistance[4] = wallClip.w + wallClip.z;
+    gl_ClipDistance[5] = wallClip.w - wallClip.z;
+
+    WallDepth = wallClip.zw;
+    gl_Position = portalMatrix * wallClip;
+}
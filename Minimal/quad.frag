@@ -0,0 +1,13 @@
+#version 330 core
+// Eye buffer stand-in for the compositor, samples a quad layer image
+
+in vec2 UV;
+
+uniform sampler2D image;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = texture(image, UV);
+}
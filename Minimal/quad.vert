@@ -0,0 +1,19 @@
+#version 330 core
+// Eye buffer stand-in for the compositor: one quad layer as a triangle strip,
+// the corners come from gl_VertexID so no vertex buffer is needed.
+
+uniform mat4 viewProjection;
+// Quad center and orientation, the image spans local x and y
+uniform mat4 pose;
+uniform vec2 size;
+// Part of the image in use
+uniform vec2 uvScale;
+
+out vec2 UV;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    UV = corner * uvScale;
+    gl_Position = viewProjection * pose * vec4((corner - 0.5) * size, 0.0, 1.0);
+}
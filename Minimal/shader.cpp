@@ -15,23 +15,47 @@ using namespace std;
 #include <GLFW/glfw3.h>
 
 #include "shader.h"
+#include "Program.h"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+// Appends a shader file to ShaderCode. A line #include "file" is replaced by that file, looked up
+// next to the including one. Returns false if a file can't be opened.
+static bool ReadShaderSource(const std::string & file_path, std::string & ShaderCode){
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
+	std::ifstream ShaderStream(file_path, std::ios::in);
+	if(!ShaderStream.is_open()){
+		printf("Impossible to open %s. Check to make sure the file exists and you passed in the right filepath!\n", file_path.c_str());
+		return false;
+	}
+	std::string Directory = file_path.substr(0, file_path.find_last_of("/\\") + 1);
+	const std::string Include = "#include \"";
+	std::string Line = "";
+	while(getline(ShaderStream, Line)){
+		if(Line.compare(0, Include.size(), Include) == 0){
+			size_t End = Line.find('"', Include.size());
+			if(!ReadShaderSource(Directory + Line.substr(Include.size(), End - Include.size()), ShaderCode))
+				return false;
+			continue;
+		}
+		ShaderCode += "\n" + Line;
+	}
+	return true;
+}
+
+// Reads and compiles a single shader stage, returns 0 if the file can't be opened or doesn't compile.
+// defines are inserted after the #version line.
+static GLuint CompileShader(GLenum type, const char * file_path, const char * defines = nullptr){
+
+	GLuint ShaderID = glCreateShader(type);
+
+	// Read the Shader code from the file
+	std::string ShaderCode;
+	if(ReadShaderSource(file_path, ShaderCode)){
+		if(defines){
+			size_t Version = ShaderCode.find("#version");
+			size_t LineEnd = Version == std::string::npos ? 0 : ShaderCode.find('\n', Version);
+			ShaderCode.insert(LineEnd == std::string::npos ? ShaderCode.size() : LineEnd, std::string("\n") + defines);
+		}
 	}else{
-		printf("Impossible to open %s. Check to make sure the file exists and you passed in the right filepath!\n", vertex_file_path);
 		printf("The current working directory is:");
 		// Please for the love of whatever deity/ies you believe in never do something like the next line of code,
 		// Especially on non-Windows systems where you can have the system happily execute "rm -rf ~"
@@ -41,67 +65,50 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 		system("pwd");
 #endif
 		getchar();
+		glDeleteShader(ShaderID);
 		return 0;
 	}
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
-	}
-
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
+	// Compile Shader
+	printf("Compiling shader : %s\n", file_path);
+	char const * SourcePointer = ShaderCode.c_str();
+	glShaderSource(ShaderID, 1, &SourcePointer , NULL);
+	glCompileShader(ShaderID);
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
-
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	// Check Shader
+	glGetShaderiv(ShaderID, GL_COMPILE_STATUS, &Result);
+	glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
+		std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		printf("%s\n", &ShaderErrorMessage[0]);
 	}
 	else {
-		printf("Successfully compiled vertex shader!\n");
+		printf("Successfully compiled shader!\n");
+	}
+	if(Result != GL_TRUE){
+		glDeleteShader(ShaderID);
+		return 0;
 	}
 
+	return ShaderID;
+}
 
+// Links the given stages into a program and releases the stages, returns 0 if linking fails
+static GLuint LinkProgram(const std::vector<GLuint> & ShaderIDs){
 
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
-
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
-	}
-	else {
-		printf("Successfully compiled fragment shader!\n");
-	}
-
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
 
 	// Link the program
 	printf("Linking program\n");
 	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
+	for(GLuint ShaderID : ShaderIDs)
+		if(ShaderID)
+			glAttachShader(ProgramID, ShaderID);
 	glLinkProgram(ProgramID);
 
 	// Check the program
@@ -112,12 +119,53 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
 		printf("%s\n", &ProgramErrorMessage[0]);
 	}
-	
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
-	
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
+
+	for(GLuint ShaderID : ShaderIDs){
+		if(!ShaderID)
+			continue;
+		glDetachShader(ProgramID, ShaderID);
+		glDeleteShader(ShaderID);
+	}
+
+	if(Result != GL_TRUE){
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+
+	// Uniform handles look their locations up in the reflection instead of asking the driver per draw
+	Program::reflect(ProgramID);
 
 	return ProgramID;
-}
\ No newline at end of file
+}
+
+// Releases the stages of a program that won't be linked, returns true if all of them compiled
+static bool AllCompiled(const std::vector<GLuint> & ShaderIDs){
+
+	if(std::find(ShaderIDs.begin(), ShaderIDs.end(), 0u) == ShaderIDs.end())
+		return true;
+	for(GLuint ShaderID : ShaderIDs)
+		if(ShaderID)
+			glDeleteShader(ShaderID);
+	return false;
+}
+
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+
+	GLuint VertexShaderID = CompileShader(GL_VERTEX_SHADER, vertex_file_path);
+	GLuint FragmentShaderID = CompileShader(GL_FRAGMENT_SHADER, fragment_file_path);
+	if(!AllCompiled({ VertexShaderID, FragmentShaderID }))
+		return 0;
+
+	return LinkProgram({ VertexShaderID, FragmentShaderID });
+}
+
+GLuint LoadShaders(const char * vertex_file_path, const char * geometry_file_path, const char * fragment_file_path, const char * defines){
+
+	GLuint VertexShaderID = CompileShader(GL_VERTEX_SHADER, vertex_file_path, defines);
+	GLuint GeometryShaderID = CompileShader(GL_GEOMETRY_SHADER, geometry_file_path, defines);
+	GLuint FragmentShaderID = CompileShader(GL_FRAGMENT_SHADER, fragment_file_path, defines);
+	if(!AllCompiled({ VertexShaderID, GeometryShaderID, FragmentShaderID }))
+		return 0;
+
+	return LinkProgram({ VertexShaderID, GeometryShaderID, FragmentShaderID });
+}
@@ -1,15 +1,128 @@
 #version 330 core
 
+// Matches Cave::MAX_WALLS
+#define MAX_WALLS 6
+// Matches Cave::EYES, the stereo program draws both eyes at once, the mono program eye 0
+#define EYES 2
+// Fixed point iterations searching the old image for the current view ray
+#define REPROJECT_STEPS 3
+// Width of the band, in inset uv, where an inset fades into its wall
+#define INSET_BLEND 0.1
+
 // in vec3 Normal;
 in vec2 UV;
+in vec3 WallPos;
+flat in int Wall;
+flat in int Eye;
 
 // You can output many things. The first vec4 type output determines the color of the fragment
 out vec3 color;
 
-uniform sampler2D textureShader;
+// Per eye uniforms are arrays, eye e's entries start at e times the count per eye
+
+// Wall images, layer i holds wall i
+uniform sampler2DArray textureShader[EYES];
+// Part of each layer holding the image, walls may render below full size
+uniform vec2 uvScale[EYES * 2 * MAX_WALLS];
+
+// Reprojection of walls rendered from an older eye position
+uniform int staleMask[EYES];
+uniform sampler2DArray depthShader[EYES];
+uniform vec3 eyePos[EYES];
+uniform mat4 toCurrent[EYES * MAX_WALLS]; // old wall clip to current world
+uniform mat4 toOld[EYES * MAX_WALLS]; // current world to old wall clip
+
+// Foveal insets, layer insetLayer + i holds the inset of wall i
+uniform int insetMask[EYES];
+uniform int insetLayer;
+uniform vec4 insetRect[EYES * MAX_WALLS]; // (u0, v0, u1, v1) on the wall
+
+// Analytic skybox behind the wall images, where their alpha is below 1
+uniform int skyMask[EYES];
+uniform samplerCube skybox[EYES];
+uniform mat3 skyRotation[EYES]; // skybox cube orientation in the wall view
+uniform float skySize; // half size of the skybox cube
+
+// Sampler arrays can only be indexed by constants here, Eye picks one by branching
+vec4 wallTexel(vec3 coord)
+{
+    return Eye == 0 ? texture(textureShader[0], coord) : texture(textureShader[1], coord);
+}
+
+float wallDepth(vec3 coord)
+{
+    return Eye == 0 ? texture(depthShader[0], coord).r : texture(depthShader[1], coord).r;
+}
+
+vec3 skyTexel(vec3 dir)
+{
+    return Eye == 0 ? texture(skybox[0], dir).rgb : texture(skybox[1], dir).rgb;
+}
+
+vec2 project(mat4 m, vec3 p)
+{
+    vec4 clip = m * vec4(p, 1.0);
+    return clip.xy / clip.w * 0.5 + 0.5;
+}
+
+// Where the old image shows what the current eye sees through this fragment.
+// Starts at the fragment itself, then repeatedly moves the depth found there
+// onto the current view ray and looks it up again.
+vec2 reproject(vec2 scale)
+{
+    int wall = Eye * MAX_WALLS + Wall;
+    vec3 eye = eyePos[Eye];
+    vec3 dir = normalize(WallPos - eye);
+    vec2 uv = project(toOld[wall], WallPos);
+    for (int i = 0; i < REPROJECT_STEPS; i++) {
+        float depth = wallDepth(vec3(clamp(uv, 0.0, 1.0) * scale, Wall));
+        vec4 point = toCurrent[wall] * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+        vec3 onRay = eye + dir * max(dot(point.xyz / point.w - eye, dir), 0.0);
+        uv = project(toOld[wall], onRay);
+    }
+    return uv;
+}
+
+// The skybox texel the wall pass would have drawn here. The skybox is a finite
+// cube around the origin of the wall view, follow the ray from the eye through
+// this fragment to where it leaves the cube.
+vec3 skyColor()
+{
+    mat3 toCube = transpose(skyRotation[Eye]);
+    vec3 origin = toCube * eyePos[Eye];
+    vec3 dir = toCube * (WallPos - eyePos[Eye]);
+    vec3 exit = (skySize - origin * sign(dir)) / max(abs(dir), vec3(1e-6));
+    float t = min(exit.x, min(exit.y, exit.z));
+    return skyTexel(origin + dir * t);
+}
+
+vec4 sampleLayer(int layer, vec2 layerUV)
+{
+    // Stay half a texel inside the used area so filtering never reads stale texels
+    vec2 scale = uvScale[Eye * 2 * MAX_WALLS + layer];
+    vec2 halfTexel = Eye == 0 ? 0.5 / vec2(textureSize(textureShader[0], 0).xy) : 0.5 / vec2(textureSize(textureShader[1], 0).xy);
+    vec2 uv = clamp(layerUV * scale, halfTexel, scale - halfTexel);
+    return wallTexel(vec3(uv, layer));
+}
 
 void main()
 {
-    // Color everything a hot pink color. An alpha of 1.0f means it is not transparent.
-    color = texture(textureShader, UV).rgb;
+    int wallBit = 1 << Wall;
+    vec2 wallUV = (staleMask[Eye] & wallBit) != 0 ? reproject(uvScale[Eye * 2 * MAX_WALLS + Wall]) : UV;
+    vec4 wall = sampleLayer(Wall, wallUV);
+
+    if ((insetMask[Eye] & wallBit) != 0) {
+        vec4 rect = insetRect[Eye * MAX_WALLS + Wall];
+        vec2 insetUV = (wallUV - rect.xy) / (rect.zw - rect.xy);
+        vec2 edge = min(insetUV, 1.0 - insetUV);
+        float weight = smoothstep(0.0, INSET_BLEND, min(edge.x, edge.y));
+        if (weight > 0.0) {
+            wall = mix(wall, sampleLayer(insetLayer + Wall, insetUV), weight);
+        }
+    }
+
+    color = wall.rgb;
+    if ((skyMask[Eye] & wallBit) != 0) {
+        color = mix(skyColor(), wall.rgb, wall.a);
+    }
 }
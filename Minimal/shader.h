@@ -2,5 +2,7 @@
 #define SHADER_HPP
 
 GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+// defines, e.g. "#define VIEW_COUNT 2", go after the #version line of every stage
+GLuint LoadShaders(const char * vertex_file_path,const char * geometry_file_path,const char * fragment_file_path,const char * defines = nullptr);
 
 #endif
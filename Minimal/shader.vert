@@ -2,15 +2,33 @@
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec2 vertexUV;
+layout (location = 2) in int wallIndex;
 
-uniform mat4 projection;
-uniform mat4 model;
+// Matches ViewBlock::MAX_WALLS
+#define MAX_WALLS 6
+// Per view camera data, see ViewBlock.h
+layout (std140) uniform PerView {
+    mat4 eyeProjection;
+    mat4 eyeView;
+    mat4 wallProjection[MAX_WALLS];
+    vec4 eyePosition;
+};
+
+// Places the cave in the world the walls are projected in
 uniform mat4 view;
 
 out vec2 UV;
+out vec3 WallPos;
+flat out int Wall;
+// shader.frag indexes its per eye uniforms, a mono draw is always eye 0
+flat out int Eye;
 
 void main()
 {
-    gl_Position = projection * model * view * vec4(position.x, position.y, position.z, 1.0);
+    gl_Position = eyeProjection * eyeView * view * vec4(position.x, position.y, position.z, 1.0);
 	UV = vertexUV;
+	// view places the cave in the world the walls are projected in
+	WallPos = vec3(view * vec4(position, 1.0));
+	Wall = wallIndex;
+	Eye = 0;
 }
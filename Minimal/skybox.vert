@@ -11,12 +11,23 @@ layout (location = 1) in vec3 normal;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
+// Matches ViewBlock::MAX_WALLS
+#define MAX_WALLS 6
+// Per view camera data, see ViewBlock.h
+layout (std140) uniform PerView {
+    mat4 eyeProjection;
+    mat4 eyeView;
+    mat4 wallProjection[MAX_WALLS];
+    vec4 eyePosition;
+};
+
+// The skybox's own transform, it only turns with the eye
 uniform mat4 view;
 
 void main()
 {
     TexCoords = position;
-    gl_Position = projection * view * vec4(position, 1.0);
-    //gl_Position = pos.xyww;
+    // On the far plane, the skybox is drawn last and only fills what the depth test leaves
+    vec4 pos = eyeProjection * mat4(mat3(eyeView)) * view * vec4(position, 1.0);
+    gl_Position = pos.xyww;
 }  
\ No newline at end of file
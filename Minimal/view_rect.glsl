@@ -0,0 +1,27 @@
+// Included by the *_stereo.geom shaders. True if a primitive, given by its clip
+// space vertices, lies entirely beside rect, a view's (x0, y0, x1, y1) part of
+// the eye's NDC. Only decidable in front of the eye, a primitive with a vertex
+// behind it is kept.
+
+bool besideRect(vec2 lower, vec2 upper, vec4 rect)
+{
+    return upper.x < rect.x || lower.x > rect.z || upper.y < rect.y || lower.y > rect.w;
+}
+
+bool besideRect(vec4 a, vec4 b, vec4 rect)
+{
+    if (min(a.w, b.w) <= 0.0) {
+        return false;
+    }
+    vec2 na = a.xy / a.w, nb = b.xy / b.w;
+    return besideRect(min(na, nb), max(na, nb), rect);
+}
+
+bool besideRect(vec4 a, vec4 b, vec4 c, vec4 rect)
+{
+    if (min(a.w, min(b.w, c.w)) <= 0.0) {
+        return false;
+    }
+    vec2 na = a.xy / a.w, nb = b.xy / b.w, nc = c.xy / c.w;
+    return besideRect(min(na, min(nb, nc)), max(na, max(nb, nc)), rect);
+}
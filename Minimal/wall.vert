@@ -0,0 +1,16 @@
+#version 410 core
+// Vertex stage of the layered CAVE wall pass. The per-wall off-axis
+// projection is applied in wall.geom once the target layer is known.
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+
+out vec3 vTexCoords;
+
+uniform mat4 view;
+
+void main()
+{
+    vTexCoords = position;
+    gl_Position = view * vec4(position, 1.0);
+}
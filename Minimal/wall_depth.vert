@@ -0,0 +1,23 @@
+#version 330 core
+// Cave wall position only, for the stencil and depth passes of portal mode.
+// Color writes are masked there, so no wall image is sampled.
+
+layout (location = 0) in vec3 position;
+
+// Matches ViewBlock::MAX_WALLS
+#define MAX_WALLS 6
+// Per view camera data, see ViewBlock.h
+layout (std140) uniform PerView {
+    mat4 eyeProjection;
+    mat4 eyeView;
+    mat4 wallProjection[MAX_WALLS];
+    vec4 eyePosition;
+};
+
+// Places the cave in the world
+uniform mat4 view;
+
+void main()
+{
+    gl_Position = eyeProjection * eyeView * view * vec4(position, 1.0);
+}